@@ -1,4 +1,7 @@
 #include "ini.h"
+#include "ini_scanner.h"
+
+#include <stdexcept>
 
 namespace Ini {
 
@@ -13,50 +16,144 @@ namespace Ini {
         }
     }
 
+    optional<string_view> ParseSectionName(string_view line) {
+        size_t first = line.find('[');
+
+        if (first != string_view::npos) {
+            size_t second = line.find(']', first);
+            if (second != string_view::npos && second - first > 1) {
+                return line.substr(first + 1, second - first - 1);
+            }
+        }
+
+        return nullopt;
+    }
 
     Section &Document::AddSection(string name) {
         return sections[move(name)];
     }
 
-    const Section &Document::GetSection(const string &name) const {
-        return sections.at(name);
+    const string *FindValue(const Section &section, string_view key) {
+        auto it = section.find(key);
+        return it != section.end() ? &it->second : nullptr;
+    }
+
+    const Section &Document::GetSection(string_view name) const {
+        if (const Section *section = FindSection(name)) {
+            return *section;
+        }
+        throw out_of_range("Ini::Document::GetSection: unknown section");
+    }
+
+    const Section *Document::FindSection(string_view name) const {
+        auto it = sections.find(name);
+        return it != sections.end() ? &it->second : nullptr;
+    }
+
+    const string *Document::FindValue(string_view section, string_view key) const {
+        const Section *found = FindSection(section);
+        return found != nullptr ? Ini::FindValue(*found, key) : nullptr;
     }
 
     size_t Document::SectionCount() const {
         return sections.size();
     }
 
-    Document Load(istream &input) {
-        Document newDoc;
-
-        Section *last_section_pointer = nullptr;
+    StringMap<Section>::const_iterator Document::begin() const {
+        return sections.begin();
+    }
 
-        for (string line; getline(input, line);) {
-            string_view sv(line);
+    StringMap<Section>::const_iterator Document::end() const {
+        return sections.end();
+    }
 
-            size_t first = sv.find('[');
+    void Document::Merge(Document &&other) {
+        for (auto &[name, section] : other.sections) {
+            Section &target = sections[name];
+            if (target.empty()) {
+                target = move(section);
+            } else {
+                target.merge(section);
+            }
+        }
+        other.sections.clear();
+    }
 
-            if (first != string_view::npos) {
-                size_t second = sv.find(']', first);
-                if (second != string_view::npos && second - first > 1) {
-                    auto section_name = sv.substr(first + 1, second - 1);
-                    last_section_pointer = &newDoc.AddSection({section_name.begin(), section_name.end()});
-                    continue;
-                }
+    namespace {
+        class DocumentBuilder : public Visitor {
+        public:
+            bool OnSection(string_view name) override {
+                last_section_pointer = &doc.AddSection({name.begin(), name.end()});
+                return true;
             }
 
-            pair<string_view, string_view> key_value = Split(line, '=');
-            if (!key_value.first.empty() && !key_value.second.empty()) {
-                (*last_section_pointer).insert(
+            bool OnKeyValue(string_view key, string_view value) override {
+                last_section_pointer->insert(
                         {
-                                string{key_value.first.begin(), key_value.first.end()},
-                                string{key_value.second.begin(), key_value.second.end()}
+                                string{key.begin(), key.end()},
+                                string{value.begin(), value.end()}
                         }
                 );
+                return true;
+            }
+
+            Document Build() {
+                return move(doc);
+            }
+
+        private:
+            Document doc;
+            Section *last_section_pointer = nullptr;
+        };
+
+        // Общие правила для обоих вариантов Parse: пары ключ-значение
+        // до первой секции и пары с пустым ключом или значением пропускаются
+        bool Dispatch(optional<string_view> section_name, pair<string_view, string_view> key_value,
+                      bool &in_section, Visitor &visitor) {
+            if (section_name) {
+                in_section = true;
+                return visitor.OnSection(*section_name);
+            }
+            if (in_section && !key_value.first.empty() && !key_value.second.empty()) {
+                return visitor.OnKeyValue(key_value.first, key_value.second);
+            }
+            return true;
+        }
+    }
+
+    void Parse(istream &input, Visitor &visitor) {
+        bool in_section = false;
+        for (string line; getline(input, line);) {
+            auto section_name = ParseSectionName(line);
+            auto key_value = section_name ? pair<string_view, string_view>{} : Split(line, '=');
+            if (!Dispatch(section_name, key_value, in_section, visitor)) {
+                return;
+            }
+        }
+    }
+
+    void Parse(string_view text, Visitor &visitor) {
+        bool in_section = false;
+        LineScanner scanner(text);
+        for (LineMarks marks; scanner.Next(marks);) {
+            auto section_name = marks.SectionName();
+            auto key_value = section_name ? pair<string_view, string_view>{} : marks.KeyValue();
+            if (!Dispatch(section_name, key_value, in_section, visitor)) {
+                return;
             }
         }
+    }
+
+    Document Load(istream &input) {
+        DocumentBuilder builder;
+        Parse(input, builder);
+        return builder.Build();
+    }
 
-        return move(newDoc);
+    Document Load(string_view text) {
+        DocumentBuilder builder;
+        Parse(text, builder);
+        return builder.Build();
     }
 
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <optional>
 #include <unordered_map>
 #include <iostream>
 
@@ -8,20 +10,71 @@ using namespace std;
 
 namespace Ini {
 
-    using Section = unordered_map<string, string>;
+    // Позволяет искать по string_view без создания временной строки
+    struct StringHash {
+        using is_transparent = void;
+
+        size_t operator()(string_view s) const {
+            return hash<string_view>{}(s);
+        }
+    };
+
+    template<typename Value>
+    using StringMap = unordered_map<string, Value, StringHash, equal_to<>>;
+
+    using Section = StringMap<string>;
+
+    // В отличие от Section::at, не бросает исключение для отсутствующего ключа
+    const string *FindValue(const Section &section, string_view key);
 
     class Document {
     public:
         Section &AddSection(string name);
 
-        const Section &GetSection(const string &name) const;
+        const Section &GetSection(string_view name) const;
+
+        const Section *FindSection(string_view name) const;
+
+        const string *FindValue(string_view section, string_view key) const;
 
         size_t SectionCount() const;
 
+        StringMap<Section>::const_iterator begin() const;
+
+        StringMap<Section>::const_iterator end() const;
+
+        // Добавляет секции other так, как если бы его текст шёл после текста
+        // этого документа: уже существующие ключи не перезаписываются
+        void Merge(Document &&other);
+
     private:
-        unordered_map<string, Section> sections;
+        StringMap<Section> sections;
     };
 
+    pair<string_view, string_view> Split(string_view line, char by);
+
+    // Если строка является заголовком секции вида "[name]", возвращает name
+    optional<string_view> ParseSectionName(string_view line);
+
+    // Получает события разбора по мере чтения текста, не накапливая документ.
+    // Если обработчик возвращает false, разбор останавливается.
+    class Visitor {
+    public:
+        virtual ~Visitor() = default;
+
+        virtual bool OnSection(string_view name) = 0;
+
+        // Вызывается только внутри секции и только для непустых ключа и значения
+        virtual bool OnKeyValue(string_view key, string_view value) = 0;
+    };
+
+    void Parse(istream &input, Visitor &visitor);
+
+    void Parse(string_view text, Visitor &visitor);
+
     Document Load(istream &input);
 
+    // Разбирает текст, уже находящийся в памяти, одним проходом LineScanner
+    Document Load(string_view text);
+
 }
\ No newline at end of file
@@ -0,0 +1,310 @@
+#include "profile.h"
+
+#include "ini.h"
+#include "ini_compiled.h"
+#include "ini_flat.h"
+#include "ini_mapped.h"
+#include "ini_parallel.h"
+#include "ini_scanner.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+// Собирайте с -DCMAKE_BUILD_TYPE=Release, иначе цифры не показательны.
+//
+// Параметры (все необязательны):
+//   --size-mb N          размер сгенерированного текста, по умолчанию 64
+//   --sections N         число различных имён секций, по умолчанию 10000
+//   --key-min N          минимальная длина ключа, по умолчанию 4
+//   --key-max N          максимальная длина ключа, по умолчанию 24
+//   --value-len N        длина значения, по умолчанию 12
+//   --duplicate-ratio X  доля повторных ключей внутри секции, по умолчанию 0.05
+//   --lookups N          число поисков ключей, по умолчанию 1000000
+//   --seed N             зерно генератора, по умолчанию 42
+//   --threads N          потоков для LoadParallel, по умолчанию все ядра
+
+namespace {
+    atomic<size_t> allocation_count{0};
+    atomic<size_t> allocated_bytes{0};
+}
+
+void *operator new(size_t size) {
+    allocation_count.fetch_add(1, memory_order_relaxed);
+    allocated_bytes.fetch_add(size, memory_order_relaxed);
+    if (void *p = malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+struct BenchmarkConfig {
+    size_t size_mb = 64;
+    size_t sections = 10000;
+    size_t key_min = 4;
+    size_t key_max = 24;
+    size_t value_len = 12;
+    double duplicate_ratio = 0.05;
+    size_t lookups = 1'000'000;
+    uint64_t seed = 42;
+    size_t threads = thread::hardware_concurrency();
+};
+
+BenchmarkConfig ParseArgs(int argc, char **argv) {
+    BenchmarkConfig config;
+    for (int i = 1; i < argc; i += 2) {
+        const string flag = argv[i];
+        if (i + 1 == argc) {
+            throw invalid_argument("missing value for " + flag);
+        }
+        const string value = argv[i + 1];
+        if (flag == "--size-mb") {
+            config.size_mb = stoul(value);
+        } else if (flag == "--sections") {
+            config.sections = max<size_t>(stoul(value), 1);
+        } else if (flag == "--key-min") {
+            config.key_min = max<size_t>(stoul(value), 1);
+        } else if (flag == "--key-max") {
+            config.key_max = stoul(value);
+        } else if (flag == "--value-len") {
+            config.value_len = max<size_t>(stoul(value), 1);
+        } else if (flag == "--duplicate-ratio") {
+            config.duplicate_ratio = stod(value);
+        } else if (flag == "--lookups") {
+            config.lookups = stoul(value);
+        } else if (flag == "--seed") {
+            config.seed = stoull(value);
+        } else if (flag == "--threads") {
+            config.threads = max<size_t>(stoul(value), 1);
+        } else {
+            throw invalid_argument("unknown flag " + flag);
+        }
+    }
+    config.key_max = max(config.key_max, config.key_min);
+    return config;
+}
+
+struct GeneratedIni {
+    string text;
+    vector<pair<string, string>> probes;
+};
+
+// Секции идут по кругу по пулу имён, так что при достаточном объёме
+// каждая секция встречается несколько раз и сливается при загрузке
+GeneratedIni GenerateIni(const BenchmarkConfig &config) {
+    mt19937_64 random(config.seed);
+    uniform_int_distribution<size_t> key_length(config.key_min, config.key_max);
+    uniform_int_distribution<int> letter('a', 'z');
+    bernoulli_distribution duplicate(config.duplicate_ratio);
+
+    const size_t target = config.size_mb << 20;
+    const size_t line_size = (config.key_min + config.key_max) / 2 + config.value_len + 2;
+    const size_t keys_per_section = max<size_t>(target / config.sections / line_size, 1);
+
+    GeneratedIni result;
+    result.text.reserve(target + target / 8);
+    vector<string> section_keys;
+
+    for (size_t i = 0; result.text.size() < target; ++i) {
+        const string section = "section_" + to_string(i % config.sections);
+        result.text += "[" + section + "]\n";
+
+        section_keys.clear();
+        for (size_t j = 0; j < keys_per_section; ++j) {
+            string key;
+            if (!section_keys.empty() && duplicate(random)) {
+                key = section_keys[random() % section_keys.size()];
+            } else {
+                key.resize(key_length(random));
+                for (char &c : key) {
+                    c = static_cast<char>(letter(random));
+                }
+                section_keys.push_back(key);
+            }
+
+            string value(config.value_len, '0');
+            for (char &c : value) {
+                c = static_cast<char>('0' + random() % 10);
+            }
+            result.text += key + "=" + value + "\n";
+
+            if (result.probes.size() < 4096 && random() % 64 == 0) {
+                result.probes.emplace_back(section, key);
+            }
+        }
+        result.text += "\n";
+    }
+
+    // Заведомо отсутствующие ключи, чтобы мерить и неудачный поиск
+    for (size_t i = 0; i < 256; ++i) {
+        result.probes.emplace_back("section_" + to_string(i % config.sections), "missing_" + to_string(i));
+    }
+    return result;
+}
+
+// Сбрасывает пиковый RSS процесса (Linux >= 4.0), чтобы VmHWM
+// показывал пик только текущего замера
+void ResetPeakRss() {
+    ofstream("/proc/self/clear_refs") << "5";
+}
+
+size_t PeakRssKb() {
+    ifstream status("/proc/self/status");
+    for (string line; getline(status, line);) {
+        if (line.rfind("VmHWM:", 0) == 0) {
+            return stoul(line.substr(6));
+        }
+    }
+    return 0;
+}
+
+// Замеряет время через TotalDuration, чтобы вывод совпадал по формату
+// с остальными замерами в репозитории, и добавляет к нему MB/s,
+// число и объём выделений памяти и пиковый RSS
+void Measure(const string &name, size_t bytes, const function<void()> &action) {
+    TotalDuration total(name);
+    ResetPeakRss();
+    const size_t allocations_before = allocation_count.load();
+    const size_t bytes_before = allocated_bytes.load();
+    {
+        ADD_DURATION(total);
+        action();
+    }
+    const double seconds = duration_cast<duration<double>>(total.value).count();
+    cerr << name << ": " << (bytes / double(1 << 20)) / max(seconds, 1e-9) << " MB/s, "
+         << allocation_count.load() - allocations_before << " allocations, "
+         << (allocated_bytes.load() - bytes_before) / (1 << 20) << " MB allocated, "
+         << "peak RSS " << PeakRssKb() / 1024 << " MB" << endl;
+}
+
+size_t CountWithGetline(const string &text) {
+    istringstream input(text);
+    size_t count = 0;
+    for (string line; getline(input, line);) {
+        if (Ini::ParseSectionName(line)) {
+            ++count;
+            continue;
+        }
+        auto key_value = Ini::Split(line, '=');
+        count += !key_value.first.empty() && !key_value.second.empty();
+    }
+    return count;
+}
+
+size_t CountWithScanner(const string &text) {
+    Ini::LineScanner scanner(text);
+    size_t count = 0;
+    for (Ini::LineMarks marks; scanner.Next(marks);) {
+        if (marks.SectionName()) {
+            ++count;
+            continue;
+        }
+        auto key_value = marks.KeyValue();
+        count += !key_value.first.empty() && !key_value.second.empty();
+    }
+    return count;
+}
+
+template<typename FindFunc>
+void MeasureLookups(const string &name, const GeneratedIni &generated, size_t lookups, FindFunc find) {
+    size_t found = 0;
+    {
+        TotalDuration total(name);
+        ADD_DURATION(total);
+        for (size_t i = 0; i < lookups; ++i) {
+            const auto &[section, key] = generated.probes[i % generated.probes.size()];
+            found += find(section, key);
+        }
+    }
+    cerr << name << ": " << found << " of " << lookups << " found, " << lookups - found << " missed" << endl;
+}
+
+int main(int argc, char **argv) {
+    BenchmarkConfig config;
+    try {
+        config = ParseArgs(argc, argv);
+    } catch (const exception &e) {
+        cerr << "Usage error: " << e.what() << endl;
+        return 2;
+    }
+
+    GeneratedIni generated;
+    {
+        LOG_DURATION("Generate");
+        generated = GenerateIni(config);
+    }
+    const string &text = generated.text;
+    const size_t size = text.size();
+    cerr << "Input size: " << size / (1 << 20) << " MB, " << config.sections << " distinct sections" << endl;
+
+    const string text_path = (filesystem::temp_directory_path() / "ini_benchmark.ini").string();
+    const string compiled_path = (filesystem::temp_directory_path() / "ini_benchmark.bin").string();
+    ofstream(text_path, ios::binary) << text;
+
+    size_t getline_count = 0, scanner_count = 0;
+    Measure("Tokenize, getline + find", size, [&] { getline_count = CountWithGetline(text); });
+    Measure("Tokenize, LineScanner", size, [&] { scanner_count = CountWithScanner(text); });
+    if (getline_count != scanner_count) {
+        cerr << "Mismatch: " << getline_count << " != " << scanner_count << endl;
+        return 1;
+    }
+
+    Measure("Load(istream&)", size, [&] {
+        istringstream input(text);
+        Ini::Load(input);
+    });
+
+    Ini::Document doc;
+    Measure("Load(string_view)", size, [&] { doc = Ini::Load(string_view(text)); });
+    Measure("LoadParallel", size, [&] { Ini::LoadParallel(text, config.threads); });
+
+    Ini::FlatDocument flat;
+    Measure("LoadFlat", size, [&] { flat = Ini::LoadFlat(string_view(text)); });
+    cerr << "FlatDocument memory: " << flat.AllocatedBytes() / (1 << 20) << " MB" << endl;
+
+    optional<Ini::MappedDocument> mapped;
+    Measure("LoadFile", size, [&] { mapped.emplace(Ini::LoadFile(text_path)); });
+
+    Measure("Compile", size, [&] { Ini::Compile(doc, compiled_path); });
+    optional<Ini::CompiledDocument> compiled;
+    Measure("OpenCompiled", size, [&] { compiled.emplace(Ini::OpenCompiled(compiled_path)); });
+
+    MeasureLookups("Lookup, Document", generated, config.lookups, [&](const string &section, const string &key) {
+        return doc.FindValue(section, key) != nullptr;
+    });
+    MeasureLookups("Lookup, FlatDocument", generated, config.lookups, [&](const string &section, const string &key) {
+        const Ini::FlatSection *found = flat.FindSection(section);
+        return found != nullptr && found->Find(key).has_value();
+    });
+    MeasureLookups("Lookup, MappedDocument", generated, config.lookups, [&](const string &section, const string &key) {
+        const Ini::MappedSection *found = mapped->FindSection(section);
+        return found != nullptr && found->Find(key).has_value();
+    });
+    MeasureLookups("Lookup, CompiledDocument", generated, config.lookups, [&](const string &section, const string &key) {
+        const optional<Ini::CompiledSection> found = compiled->FindSection(section);
+        return found && found->Find(key).has_value();
+    });
+
+    remove(text_path.c_str());
+    remove(compiled_path.c_str());
+    return 0;
+}
@@ -0,0 +1,231 @@
+#include "ini_compiled.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace Ini {
+
+    using namespace Compiled;
+
+    uint64_t Compiled::Hash(string_view s) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (char c : s) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    namespace {
+        uint64_t SlotCountFor(size_t key_count) {
+            uint64_t count = 1;
+            while (count * 3 < key_count * 4 + 4) {
+                count *= 2;
+            }
+            return count;
+        }
+
+        const Slot *Slots(const char *image) {
+            const auto *header = reinterpret_cast<const Header *>(image);
+            return reinterpret_cast<const Slot *>(image + header->slots_offset);
+        }
+
+        const char *Pool(const char *image) {
+            const auto *header = reinterpret_cast<const Header *>(image);
+            return image + header->pool_offset;
+        }
+
+        uint64_t PoolSize(const char *image) {
+            const auto *header = reinterpret_cast<const Header *>(image);
+            return header->file_size - header->pool_offset;
+        }
+
+        // [offset, offset + size) внутри [0, limit), без переполнения
+        bool InRange(uint64_t offset, uint64_t size, uint64_t limit) {
+            return offset <= limit && size <= limit - offset;
+        }
+
+        bool IsPowerOfTwo(uint64_t value) {
+            return value != 0 && (value & (value - 1)) == 0;
+        }
+    }
+
+    CompiledSection::CompiledSection(const char *image, const SectionEntry *entry)
+            : image(image), entry(entry) {
+    }
+
+    optional<string_view> CompiledSection::Find(string_view key) const {
+        // Образ проверяется по мере чтения, а не при открытии: сначала таблица
+        // секции, затем каждый просмотренный слот. Проб не больше числа слотов,
+        // даже если в испорченной таблице нет пустых.
+        const auto *header = reinterpret_cast<const Header *>(image);
+        if (!InRange(entry->first_slot, entry->slot_count, header->slot_count)
+            || !IsPowerOfTwo(entry->slot_count) || entry->key_count >= entry->slot_count) {
+            throw runtime_error("Ini::CompiledSection::Find: corrupted section table");
+        }
+
+        const Slot *slots = Slots(image) + entry->first_slot;
+        const char *pool = Pool(image);
+        const uint64_t pool_size = PoolSize(image);
+        const uint64_t hash = Hash(key);
+        const uint64_t mask = entry->slot_count - 1;
+
+        uint64_t i = hash & mask;
+        for (uint64_t probe = 0; probe < entry->slot_count; ++probe, i = (i + 1) & mask) {
+            const Slot &slot = slots[i];
+            if (slot.key_offset == EMPTY_SLOT) {
+                return nullopt;
+            }
+            if (!InRange(slot.key_offset, uint64_t{slot.key_size} + slot.value_size, pool_size)) {
+                throw runtime_error("Ini::CompiledSection::Find: corrupted slot");
+            }
+            if (slot.hash == hash && string_view(pool + slot.key_offset, slot.key_size) == key) {
+                return string_view(pool + slot.key_offset + slot.key_size, slot.value_size);
+            }
+        }
+        return nullopt;
+    }
+
+    string_view CompiledSection::at(string_view key) const {
+        if (auto value = Find(key)) {
+            return *value;
+        }
+        throw out_of_range("Ini::CompiledSection::at: unknown key");
+    }
+
+    size_t CompiledSection::size() const {
+        return entry->key_count;
+    }
+
+    CompiledDocument::CompiledDocument(MappedFile file) : file(move(file)) {
+    }
+
+    const Header &CompiledDocument::GetHeader() const {
+        return *reinterpret_cast<const Header *>(file.Data().data());
+    }
+
+    string_view CompiledDocument::SectionName(const SectionEntry &entry) const {
+        const char *image = file.Data().data();
+        if (!InRange(entry.name_offset, entry.name_size, PoolSize(image))) {
+            throw runtime_error("Ini::CompiledDocument::FindSection: corrupted section table");
+        }
+        return {Pool(image) + entry.name_offset, entry.name_size};
+    }
+
+    CompiledSection CompiledDocument::GetSection(string_view name) const {
+        if (optional<CompiledSection> section = FindSection(name)) {
+            return *section;
+        }
+        throw out_of_range("Ini::CompiledDocument::GetSection: unknown section");
+    }
+
+    optional<CompiledSection> CompiledDocument::FindSection(string_view name) const {
+        const char *image = file.Data().data();
+        const Header &header = GetHeader();
+        const auto *begin = reinterpret_cast<const SectionEntry *>(image + header.sections_offset);
+        const auto *end = begin + header.section_count;
+
+        auto it = lower_bound(begin, end, name, [this](const SectionEntry &entry, string_view value) {
+            return SectionName(entry) < value;
+        });
+        if (it == end || SectionName(*it) != name) {
+            return nullopt;
+        }
+        return CompiledSection(image, it);
+    }
+
+    size_t CompiledDocument::SectionCount() const {
+        return GetHeader().section_count;
+    }
+
+    void Compile(const Document &doc, const string &path) {
+        vector<pair<const string *, const Section *>> sorted;
+        for (const auto &[name, section] : doc) {
+            sorted.emplace_back(&name, &section);
+        }
+        sort(sorted.begin(), sorted.end(), [](const auto &lhs, const auto &rhs) {
+            return *lhs.first < *rhs.first;
+        });
+
+        vector<SectionEntry> entries;
+        vector<Slot> slots;
+        string pool;
+
+        for (const auto &[name, section] : sorted) {
+            SectionEntry entry{};
+            entry.name_offset = pool.size();
+            entry.name_size = static_cast<uint32_t>(name->size());
+            entry.key_count = static_cast<uint32_t>(section->size());
+            entry.first_slot = slots.size();
+            entry.slot_count = SlotCountFor(section->size());
+            pool += *name;
+
+            slots.resize(slots.size() + entry.slot_count, Slot{EMPTY_SLOT, 0, 0, 0});
+            Slot *table = slots.data() + entry.first_slot;
+            const uint64_t mask = entry.slot_count - 1;
+
+            for (const auto &[key, value] : *section) {
+                const uint64_t hash = Hash(key);
+                uint64_t i = hash & mask;
+                while (table[i].key_offset != EMPTY_SLOT) {
+                    i = (i + 1) & mask;
+                }
+                table[i] = {pool.size(), static_cast<uint32_t>(key.size()), static_cast<uint32_t>(value.size()), hash};
+                pool += key;
+                pool += value;
+            }
+
+            entries.push_back(entry);
+        }
+
+        Header header{};
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.section_count = static_cast<uint32_t>(entries.size());
+        header.sections_offset = sizeof(Header);
+        header.slots_offset = header.sections_offset + entries.size() * sizeof(SectionEntry);
+        header.slot_count = slots.size();
+        header.pool_offset = header.slots_offset + slots.size() * sizeof(Slot);
+        header.file_size = header.pool_offset + pool.size();
+
+        ofstream output(path, ios::binary | ios::trunc);
+        output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        output.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(SectionEntry));
+        output.write(reinterpret_cast<const char *>(slots.data()), slots.size() * sizeof(Slot));
+        output.write(pool.data(), pool.size());
+        if (!output) {
+            throw runtime_error("Ini::Compile: cannot write " + path);
+        }
+    }
+
+    CompiledDocument OpenCompiled(const string &path) {
+        CompiledDocument doc(MappedFile{path});
+        string_view data = doc.file.Data();
+
+        if (data.size() < sizeof(Header)) {
+            throw runtime_error("Ini::OpenCompiled: " + path + " is too small");
+        }
+        const Header &header = doc.GetHeader();
+        if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) {
+            throw runtime_error("Ini::OpenCompiled: " + path + " is not a compiled INI image");
+        }
+        // Вычитания вместо сложений: поля заголовка могут быть любыми
+        const uint64_t file_size = data.size();
+        if (header.file_size != file_size
+            || header.sections_offset < sizeof(Header) || header.sections_offset % alignof(SectionEntry) != 0
+            || header.slots_offset % alignof(Slot) != 0
+            || !InRange(header.sections_offset, 0, header.slots_offset)
+            || uint64_t{header.section_count} > (header.slots_offset - header.sections_offset) / sizeof(SectionEntry)
+            || !InRange(header.slots_offset, 0, header.pool_offset)
+            || header.slot_count > (header.pool_offset - header.slots_offset) / sizeof(Slot)
+            || header.pool_offset > file_size) {
+            throw runtime_error("Ini::OpenCompiled: " + path + " is truncated or corrupted");
+        }
+
+        return doc;
+    }
+
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "ini.h"
+#include "mapped_file.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+namespace Ini {
+
+    // Бинарный образ документа, пригодный для отображения в память:
+    //   Header | SectionEntry[section_count] | Slot[slot_count] | пул строк
+    // Секции отсортированы по имени, у каждой своя хеш-таблица ключей
+    // с линейным пробированием. Числа хранятся в порядке байт машины,
+    // на которой образ скомпилирован.
+    namespace Compiled {
+        const char MAGIC[8] = {'I', 'N', 'I', 'B', 'I', 'N', '\0', '\0'};
+        const uint32_t VERSION = 1;
+        const uint64_t EMPTY_SLOT = UINT64_MAX;
+
+        struct Header {
+            char magic[8];
+            uint32_t version;
+            uint32_t section_count;
+            uint64_t sections_offset;
+            uint64_t slots_offset;
+            uint64_t slot_count;
+            uint64_t pool_offset;
+            uint64_t file_size;
+        };
+
+        struct SectionEntry {
+            uint64_t name_offset;
+            uint32_t name_size;
+            uint32_t key_count;
+            uint64_t first_slot;
+            uint64_t slot_count;
+        };
+
+        // Байты значения лежат в пуле сразу после байт ключа
+        struct Slot {
+            uint64_t key_offset;
+            uint32_t key_size;
+            uint32_t value_size;
+            uint64_t hash;
+        };
+
+        // FNV-1a: хеш должен совпадать между сборками и запусками
+        uint64_t Hash(string_view s);
+    }
+
+    class CompiledSection {
+    public:
+        optional<string_view> Find(string_view key) const;
+
+        string_view at(string_view key) const;
+
+        size_t size() const;
+
+    private:
+        friend class CompiledDocument;
+
+        CompiledSection(const char *image, const Compiled::SectionEntry *entry);
+
+        const char *image;
+        const Compiled::SectionEntry *entry;
+    };
+
+    class CompiledDocument {
+    public:
+        CompiledSection GetSection(string_view name) const;
+
+        optional<CompiledSection> FindSection(string_view name) const;
+
+        size_t SectionCount() const;
+
+    private:
+        friend CompiledDocument OpenCompiled(const string &path);
+
+        explicit CompiledDocument(MappedFile file);
+
+        const Compiled::Header &GetHeader() const;
+
+        string_view SectionName(const Compiled::SectionEntry &entry) const;
+
+        MappedFile file;
+    };
+
+    void Compile(const Document &doc, const string &path);
+
+    // Проверяет только заголовок и размер файла, так что открытие стоит O(1);
+    // записи секций и слоты проверяются при поиске. Повреждённый образ
+    // приводит к runtime_error, а не к чтению за его пределами.
+    CompiledDocument OpenCompiled(const string &path);
+
+}
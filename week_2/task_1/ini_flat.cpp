@@ -0,0 +1,234 @@
+#include "ini_flat.h"
+#include "ini.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+namespace Ini {
+
+    namespace {
+        const size_t INITIAL_CAPACITY = 8;
+
+        size_t Hash(string_view s) {
+            return hash<string_view>{}(s);
+        }
+
+        // Таблицы расширяются, когда заполнены на 3/4
+        bool NeedsGrow(size_t count, size_t capacity) {
+            return (count + 1) * 4 > capacity * 3;
+        }
+
+        class FlatDocumentBuilder : public Visitor {
+        public:
+            explicit FlatDocumentBuilder(FlatDocument &doc) : doc(doc) {
+            }
+
+            bool OnSection(string_view name) override {
+                last_section_pointer = &doc.AddSection(name);
+                return true;
+            }
+
+            bool OnKeyValue(string_view key, string_view value) override {
+                doc.Insert(*last_section_pointer, key, value);
+                return true;
+            }
+
+        private:
+            FlatDocument &doc;
+            FlatSection *last_section_pointer = nullptr;
+        };
+    }
+
+    char *StringArena::Allocate(size_t size) {
+        if (size > left) {
+            // Длинные строки получают отдельный блок, чтобы не терять хвост текущего
+            if (size > BLOCK_SIZE / 4) {
+                blocks.push_back(make_unique<char[]>(size));
+                allocated += size;
+                return blocks.back().get();
+            }
+            blocks.push_back(make_unique<char[]>(BLOCK_SIZE));
+            allocated += BLOCK_SIZE;
+            current = blocks.back().get();
+            left = BLOCK_SIZE;
+        }
+
+        char *result = current;
+        current += size;
+        left -= size;
+        return result;
+    }
+
+    string_view StringArena::Store(string_view s) {
+        if (s.empty()) {
+            return "";
+        }
+        char *stored = Allocate(s.size());
+        memcpy(stored, s.data(), s.size());
+        return {stored, s.size()};
+    }
+
+    const char *StringArena::Store(string_view first, string_view second) {
+        char *stored = Allocate(max<size_t>(first.size() + second.size(), 1));
+        memcpy(stored, first.data(), first.size());
+        memcpy(stored + first.size(), second.data(), second.size());
+        return stored;
+    }
+
+    size_t StringArena::AllocatedBytes() const {
+        return allocated + blocks.capacity() * sizeof(blocks[0]);
+    }
+
+    string_view FlatSection::Slot::Key() const {
+        return {data, key_size};
+    }
+
+    string_view FlatSection::Slot::Value() const {
+        return {data + key_size, value_size};
+    }
+
+    size_t FlatSection::FindSlot(string_view key) const {
+        const size_t mask = slots.size() - 1;
+        for (size_t i = Hash(key) & mask;; i = (i + 1) & mask) {
+            if (slots[i].data == nullptr || slots[i].Key() == key) {
+                return i;
+            }
+        }
+    }
+
+    void FlatSection::Grow() {
+        vector<Slot> old = move(slots);
+        slots.assign(old.empty() ? INITIAL_CAPACITY : old.size() * 2, Slot{});
+        for (const Slot &slot : old) {
+            if (slot.data != nullptr) {
+                slots[FindSlot(slot.Key())] = slot;
+            }
+        }
+    }
+
+    optional<string_view> FlatSection::Find(string_view key) const {
+        if (slots.empty()) {
+            return nullopt;
+        }
+        const Slot &slot = slots[FindSlot(key)];
+        if (slot.data == nullptr) {
+            return nullopt;
+        }
+        return slot.Value();
+    }
+
+    string_view FlatSection::at(string_view key) const {
+        if (auto value = Find(key)) {
+            return *value;
+        }
+        throw out_of_range("Ini::FlatSection::at: unknown key");
+    }
+
+    size_t FlatSection::size() const {
+        return count;
+    }
+
+    bool FlatSection::empty() const {
+        return count == 0;
+    }
+
+    size_t FlatSection::AllocatedBytes() const {
+        return slots.capacity() * sizeof(Slot);
+    }
+
+    size_t FlatDocument::FindSlot(string_view name) const {
+        const size_t mask = slots.size() - 1;
+        for (size_t i = Hash(name) & mask;; i = (i + 1) & mask) {
+            if (slots[i].name.data() == nullptr || slots[i].name == name) {
+                return i;
+            }
+        }
+    }
+
+    void FlatDocument::Grow() {
+        vector<SectionSlot> old = move(slots);
+        slots.assign(old.empty() ? INITIAL_CAPACITY : old.size() * 2, SectionSlot{});
+        for (const SectionSlot &slot : old) {
+            if (slot.name.data() != nullptr) {
+                slots[FindSlot(slot.name)] = slot;
+            }
+        }
+    }
+
+    FlatSection &FlatDocument::AddSection(string_view name) {
+        if (NeedsGrow(sections.size(), slots.size())) {
+            Grow();
+        }
+
+        SectionSlot &slot = slots[FindSlot(name)];
+        if (slot.name.data() == nullptr) {
+            slot.name = arena.Store(name);
+            slot.index = static_cast<uint32_t>(sections.size());
+            sections.emplace_back();
+        }
+        return sections[slot.index];
+    }
+
+    const FlatSection &FlatDocument::GetSection(string_view name) const {
+        if (const FlatSection *section = FindSection(name)) {
+            return *section;
+        }
+        throw out_of_range("Ini::FlatDocument::GetSection: unknown section");
+    }
+
+    const FlatSection *FlatDocument::FindSection(string_view name) const {
+        if (!slots.empty()) {
+            const SectionSlot &slot = slots[FindSlot(name)];
+            if (slot.name.data() != nullptr) {
+                return &sections[slot.index];
+            }
+        }
+        return nullptr;
+    }
+
+    size_t FlatDocument::SectionCount() const {
+        return sections.size();
+    }
+
+    bool FlatDocument::Insert(FlatSection &section, string_view key, string_view value) {
+        if (NeedsGrow(section.count, section.slots.size())) {
+            section.Grow();
+        }
+
+        FlatSection::Slot &slot = section.slots[section.FindSlot(key)];
+        if (slot.data != nullptr) {
+            return false;
+        }
+        slot.data = arena.Store(key, value);
+        slot.key_size = static_cast<uint32_t>(key.size());
+        slot.value_size = static_cast<uint32_t>(value.size());
+        ++section.count;
+        return true;
+    }
+
+    size_t FlatDocument::AllocatedBytes() const {
+        size_t result = arena.AllocatedBytes() + slots.capacity() * sizeof(SectionSlot)
+                        + sections.size() * sizeof(FlatSection);
+        for (const FlatSection &section : sections) {
+            result += section.AllocatedBytes();
+        }
+        return result;
+    }
+
+    FlatDocument LoadFlat(string_view text) {
+        FlatDocument doc;
+        FlatDocumentBuilder builder(doc);
+        Parse(text, builder);
+        return doc;
+    }
+
+    FlatDocument LoadFlat(istream &input) {
+        const string text{istreambuf_iterator<char>(input), istreambuf_iterator<char>()};
+        return LoadFlat(string_view(text));
+    }
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace Ini {
+
+    // Байты всех строк документа складываются в крупные блоки, которые
+    // никогда не перемещаются, так что выданные string_view остаются валидными
+    class StringArena {
+    public:
+        string_view Store(string_view s);
+
+        // Кладёт строки подряд и возвращает указатель на начало первой
+        const char *Store(string_view first, string_view second);
+
+        size_t AllocatedBytes() const;
+
+    private:
+        static const size_t BLOCK_SIZE = 64 * 1024;
+
+        char *Allocate(size_t size);
+
+        vector<unique_ptr<char[]>> blocks;
+        char *current = nullptr;
+        size_t left = 0;
+        size_t allocated = 0;
+    };
+
+    // Таблица с открытой адресацией и линейным пробированием. Байты ключа
+    // и значения лежат в арене подряд, поэтому слот занимает 16 байт.
+    // Пустой слот отличается от занятого тем, что data == nullptr.
+    class FlatSection {
+    public:
+        optional<string_view> Find(string_view key) const;
+
+        string_view at(string_view key) const;
+
+        size_t size() const;
+
+        bool empty() const;
+
+        size_t AllocatedBytes() const;
+
+    private:
+        friend class FlatDocument;
+
+        struct Slot {
+            const char *data = nullptr;
+            uint32_t key_size = 0;
+            uint32_t value_size = 0;
+
+            string_view Key() const;
+
+            string_view Value() const;
+        };
+
+        size_t FindSlot(string_view key) const;
+
+        void Grow();
+
+        vector<Slot> slots;
+        size_t count = 0;
+    };
+
+    // Альтернатива Document: одна арена для всех строк и плоские таблицы
+    // для секций и ключей вместо узловых unordered_map
+    class FlatDocument {
+    public:
+        FlatSection &AddSection(string_view name);
+
+        const FlatSection &GetSection(string_view name) const;
+
+        const FlatSection *FindSection(string_view name) const;
+
+        size_t SectionCount() const;
+
+        // Как Section::insert: существующий ключ не перезаписывается
+        bool Insert(FlatSection &section, string_view key, string_view value);
+
+        size_t AllocatedBytes() const;
+
+    private:
+        struct SectionSlot {
+            string_view name;
+            uint32_t index = 0;
+        };
+
+        size_t FindSlot(string_view name) const;
+
+        void Grow();
+
+        StringArena arena;
+        deque<FlatSection> sections;
+        vector<SectionSlot> slots;
+    };
+
+    FlatDocument LoadFlat(string_view text);
+
+    FlatDocument LoadFlat(istream &input);
+
+}
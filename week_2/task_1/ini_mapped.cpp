@@ -0,0 +1,106 @@
+#include "ini_mapped.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Ini {
+
+    namespace {
+        bool KeyLess(const MappedSection::Entry &lhs, const MappedSection::Entry &rhs) {
+            return lhs.first < rhs.first;
+        }
+
+        bool KeyEqual(const MappedSection::Entry &lhs, const MappedSection::Entry &rhs) {
+            return lhs.first == rhs.first;
+        }
+    }
+
+    optional<string_view> MappedSection::Find(string_view key) const {
+        auto it = lower_bound(entries.begin(), entries.end(), Entry{key, {}}, KeyLess);
+        if (it != entries.end() && it->first == key) {
+            return it->second;
+        }
+        return nullopt;
+    }
+
+    string_view MappedSection::at(string_view key) const {
+        if (auto value = Find(key)) {
+            return *value;
+        }
+        throw out_of_range("Ini::MappedSection::at: unknown key");
+    }
+
+    size_t MappedSection::size() const {
+        return entries.size();
+    }
+
+    bool MappedSection::empty() const {
+        return entries.empty();
+    }
+
+    vector<MappedSection::Entry>::const_iterator MappedSection::begin() const {
+        return entries.begin();
+    }
+
+    vector<MappedSection::Entry>::const_iterator MappedSection::end() const {
+        return entries.end();
+    }
+
+    // Как и Section::insert в Load, при повторе ключа побеждает первое значение:
+    // stable_sort сохраняет порядок появления, а unique оставляет первый элемент.
+    void MappedSection::Finalize() {
+        stable_sort(entries.begin(), entries.end(), KeyLess);
+        entries.erase(unique(entries.begin(), entries.end(), KeyEqual), entries.end());
+        entries.shrink_to_fit();
+    }
+
+    class MappedDocument::Builder : public Visitor {
+    public:
+        explicit Builder(MappedDocument &doc) : doc(doc) {
+        }
+
+        bool OnSection(string_view name) override {
+            last_section_pointer = &doc.sections[name];
+            return true;
+        }
+
+        bool OnKeyValue(string_view key, string_view value) override {
+            last_section_pointer->entries.emplace_back(key, value);
+            return true;
+        }
+
+    private:
+        MappedDocument &doc;
+        MappedSection *last_section_pointer = nullptr;
+    };
+
+    MappedDocument::MappedDocument(MappedFile file) : file(move(file)) {
+    }
+
+    const MappedSection &MappedDocument::GetSection(string_view name) const {
+        return sections.at(name);
+    }
+
+    const MappedSection *MappedDocument::FindSection(string_view name) const {
+        auto it = sections.find(name);
+        return it != sections.end() ? &it->second : nullptr;
+    }
+
+    size_t MappedDocument::SectionCount() const {
+        return sections.size();
+    }
+
+    MappedDocument LoadFile(const string &path) {
+        MappedDocument doc(MappedFile{path});
+
+        MappedDocument::Builder builder(doc);
+        Parse(doc.file.Data(), builder);
+
+        for (auto &[name, section] : doc.sections) {
+            section.Finalize();
+        }
+
+        return doc;
+    }
+
+}
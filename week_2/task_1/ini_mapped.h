@@ -0,0 +1,70 @@
+#pragma once
+
+#include "ini.h"
+#include "mapped_file.h"
+
+#include <string>
+#include <string_view>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace Ini {
+
+    class MappedDocument;
+
+    MappedDocument LoadFile(const string &path);
+
+    // Секция, ключи и значения которой указывают прямо в отображённый файл.
+    // Пары хранятся в одном векторе, отсортированном по ключу.
+    class MappedSection {
+    public:
+        using Entry = pair<string_view, string_view>;
+
+        optional<string_view> Find(string_view key) const;
+
+        string_view at(string_view key) const;
+
+        size_t size() const;
+
+        bool empty() const;
+
+        vector<Entry>::const_iterator begin() const;
+
+        vector<Entry>::const_iterator end() const;
+
+    private:
+        friend class MappedDocument;
+
+        friend MappedDocument LoadFile(const string &path);
+
+        void Finalize();
+
+        vector<Entry> entries;
+    };
+
+    // Документ владеет отображением файла, поэтому все string_view
+    // секций живут столько же, сколько сам документ.
+    class MappedDocument {
+    public:
+        const MappedSection &GetSection(string_view name) const;
+
+        const MappedSection *FindSection(string_view name) const;
+
+        size_t SectionCount() const;
+
+    private:
+        friend MappedDocument LoadFile(const string &path);
+
+        class Builder;
+
+        explicit MappedDocument(MappedFile file);
+
+        MappedFile file;
+        unordered_map<string_view, MappedSection> sections;
+    };
+
+}
@@ -0,0 +1,69 @@
+#include "ini_overlay.h"
+
+#include <stdexcept>
+
+namespace Ini {
+
+    OverlayDocument::OverlayDocument(shared_ptr<const Document> base, Document overrides)
+            : base(move(base)), overrides(move(overrides)) {
+        for (const auto &[name, section] : this->overrides) {
+            if (this->base->FindSection(name) == nullptr) {
+                ++sections_only_in_overrides;
+            }
+        }
+    }
+
+    void OverlayDocument::Set(string_view section, string_view key, string value) {
+        if (overrides.FindSection(section) == nullptr && base->FindSection(section) == nullptr) {
+            ++sections_only_in_overrides;
+        }
+        overrides.AddSection(string(section)).insert_or_assign(string(key), move(value));
+    }
+
+    const string *OverlayDocument::FindValue(string_view section, string_view key) const {
+        if (const string *value = overrides.FindValue(section, key)) {
+            return value;
+        }
+        return base->FindValue(section, key);
+    }
+
+    const string &OverlayDocument::GetValue(string_view section, string_view key) const {
+        if (const string *value = FindValue(section, key)) {
+            return *value;
+        }
+        throw out_of_range("Ini::OverlayDocument::GetValue: unknown key");
+    }
+
+    bool OverlayDocument::HasSection(string_view name) const {
+        return overrides.FindSection(name) != nullptr || base->FindSection(name) != nullptr;
+    }
+
+    size_t OverlayDocument::SectionCount() const {
+        return base->SectionCount() + sections_only_in_overrides;
+    }
+
+    Section OverlayDocument::MaterializeSection(string_view name) const {
+        const Section *base_section = base->FindSection(name);
+        const Section *override_section = overrides.FindSection(name);
+        if (base_section == nullptr && override_section == nullptr) {
+            throw out_of_range("Ini::OverlayDocument::MaterializeSection: unknown section");
+        }
+
+        Section result = base_section != nullptr ? *base_section : Section{};
+        if (override_section != nullptr) {
+            for (const auto &[key, value] : *override_section) {
+                result.insert_or_assign(key, value);
+            }
+        }
+        return result;
+    }
+
+    const Document &OverlayDocument::Base() const {
+        return *base;
+    }
+
+    const Document &OverlayDocument::Overrides() const {
+        return overrides;
+    }
+
+}
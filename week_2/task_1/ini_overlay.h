@@ -0,0 +1,45 @@
+#pragma once
+
+#include "ini.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+namespace Ini {
+
+    // Документ из общей неизменяемой базы и небольшого набора переопределений.
+    // Хранятся только переопределённые ключи, поиск проваливается в базу,
+    // поэтому память на вариант пропорциональна размеру переопределений.
+    class OverlayDocument {
+    public:
+        explicit OverlayDocument(shared_ptr<const Document> base, Document overrides = {});
+
+        // Значение из переопределений заменяет значение базы
+        void Set(string_view section, string_view key, string value);
+
+        const string *FindValue(string_view section, string_view key) const;
+
+        // Бросает out_of_range, если ключа нет ни в переопределениях, ни в базе
+        const string &GetValue(string_view section, string_view key) const;
+
+        bool HasSection(string_view name) const;
+
+        size_t SectionCount() const;
+
+        // Собирает секцию целиком: ключи базы с наложенными поверх переопределениями
+        Section MaterializeSection(string_view name) const;
+
+        const Document &Base() const;
+
+        const Document &Overrides() const;
+
+    private:
+        shared_ptr<const Document> base;
+        Document overrides;
+        size_t sections_only_in_overrides = 0;
+    };
+
+}
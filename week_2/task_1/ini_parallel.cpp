@@ -0,0 +1,66 @@
+#include "ini_parallel.h"
+#include "ini_scanner.h"
+
+#include <algorithm>
+#include <future>
+#include <utility>
+#include <vector>
+
+namespace Ini {
+
+    namespace {
+        // Сдвигает позицию pos к началу ближайшей строки-заголовка секции
+        size_t AlignToSection(string_view text, size_t pos) {
+            if (pos >= text.size()) {
+                return text.size();
+            }
+            if (pos > 0 && text[pos - 1] != '\n') {
+                size_t eol = text.find('\n', pos);
+                if (eol == string_view::npos) {
+                    return text.size();
+                }
+                pos = eol + 1;
+            }
+
+            LineScanner scanner(text.substr(pos));
+            for (LineMarks marks; scanner.Next(marks);) {
+                if (marks.SectionName()) {
+                    return marks.line.data() - text.data();
+                }
+            }
+            return text.size();
+        }
+    }
+
+    Document LoadParallel(string_view text, size_t thread_count) {
+        thread_count = max<size_t>(thread_count, 1);
+
+        vector<size_t> bounds = {0};
+        for (size_t i = 1; i < thread_count; ++i) {
+            size_t bound = AlignToSection(text, text.size() / thread_count * i);
+            if (bound > bounds.back()) {
+                bounds.push_back(bound);
+            }
+        }
+        if (bounds.back() < text.size()) {
+            bounds.push_back(text.size());
+        }
+
+        vector<future<Document>> futures;
+        for (size_t i = 1; i < bounds.size(); ++i) {
+            string_view chunk = text.substr(bounds[i - 1], bounds[i] - bounds[i - 1]);
+            futures.push_back(async(launch::async, [chunk] { return Load(chunk); }));
+        }
+
+        // Куски сливаются строго по порядку: merge не перезаписывает уже
+        // существующие ключи, как и Section::insert в последовательном Load,
+        // поэтому для каждого ключа остаётся первое значение в тексте
+        Document doc;
+        for (auto &f : futures) {
+            doc.Merge(f.get());
+        }
+
+        return doc;
+    }
+
+}
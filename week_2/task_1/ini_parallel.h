@@ -0,0 +1,17 @@
+#pragma once
+
+#include "ini.h"
+
+#include <string_view>
+#include <thread>
+
+using namespace std;
+
+namespace Ini {
+
+    // Делит текст на куски по границам заголовков секций, разбирает куски
+    // параллельно и сливает результат. Итоговый документ совпадает с тем,
+    // что вернул бы последовательный Load на том же тексте.
+    Document LoadParallel(string_view text, size_t thread_count = thread::hardware_concurrency());
+
+}
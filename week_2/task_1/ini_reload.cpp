@@ -0,0 +1,249 @@
+#include "ini_reload.h"
+#include "ini_scanner.h"
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <system_error>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace Ini {
+
+    namespace {
+        using SectionBytes = unordered_map<string, vector<string_view>>;
+
+        // Файл читается целиком, а не отображается в память: при записи
+        // поверх отображённого файла чтение за его новым концом даёт SIGBUS
+        string ReadFile(const string &path) {
+            ifstream input(path, ios::binary);
+            if (!input) {
+                throw runtime_error("Ini::ReloadableDocument: cannot open " + path);
+            }
+            return {istreambuf_iterator<char>(input), istreambuf_iterator<char>()};
+        }
+
+        // Для каждой секции собирает куски текста от её заголовков
+        // до следующего заголовка, в порядке появления
+        SectionBytes SplitSections(string_view text) {
+            SectionBytes result;
+            vector<string_view> *last_ranges = nullptr;
+            const char *range_start = nullptr;
+
+            LineScanner scanner(text);
+            for (LineMarks marks; scanner.Next(marks);) {
+                if (auto section_name = marks.SectionName()) {
+                    if (last_ranges != nullptr) {
+                        last_ranges->emplace_back(range_start, marks.line.data() - range_start);
+                    }
+                    last_ranges = &result[string(*section_name)];
+                    range_start = marks.line.data();
+                }
+            }
+            if (last_ranges != nullptr) {
+                last_ranges->emplace_back(range_start, text.data() + text.size() - range_start);
+            }
+
+            return result;
+        }
+
+        bool SameBytes(const vector<string_view> &lhs, const vector<string_view> &rhs) {
+            if (lhs.size() != rhs.size()) {
+                return false;
+            }
+            for (size_t i = 0; i < lhs.size(); ++i) {
+                if (lhs[i] != rhs[i]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Каждый кусок начинается с заголовка своей секции, поэтому
+        // достаточно собирать пары, не глядя на сами заголовки
+        class SectionBuilder : public Visitor {
+        public:
+            explicit SectionBuilder(Section &section) : section(section) {
+            }
+
+            bool OnSection(string_view) override {
+                return true;
+            }
+
+            bool OnKeyValue(string_view key, string_view value) override {
+                section.emplace(string(key), string(value));
+                return true;
+            }
+
+        private:
+            Section &section;
+        };
+
+        shared_ptr<const Section> ParseSection(const vector<string_view> &ranges) {
+            auto section = make_shared<Section>();
+            SectionBuilder builder(*section);
+            for (string_view range : ranges) {
+                Parse(range, builder);
+            }
+            return section;
+        }
+    }
+
+    const Section &Snapshot::GetSection(string_view name) const {
+        auto it = sections.find(name);
+        if (it == sections.end()) {
+            throw out_of_range("Ini::Snapshot::GetSection: unknown section");
+        }
+        return *it->second;
+    }
+
+    size_t Snapshot::SectionCount() const {
+        return sections.size();
+    }
+
+    ReloadableDocument::Reader::Reader(const ReloadableDocument &doc)
+            : doc(doc), version(doc.Version()), snapshot(doc.Current()) {
+    }
+
+    const Snapshot &ReloadableDocument::Reader::Get() {
+        uint64_t current_version = doc.Version();
+        if (current_version != version) {
+            version = current_version;
+            snapshot = doc.Current();
+        }
+        return *snapshot;
+    }
+
+    ReloadableDocument::ReloadableDocument(string path) : path(move(path)) {
+        Reload();
+    }
+
+    ReloadableDocument::~ReloadableDocument() {
+        StopWatching();
+    }
+
+    shared_ptr<const Snapshot> ReloadableDocument::Current() const {
+        return snapshot.load();
+    }
+
+    uint64_t ReloadableDocument::Version() const {
+        return version.load(memory_order_acquire);
+    }
+
+    size_t ReloadableDocument::Reload() {
+        lock_guard<mutex> guard(reload_mutex);
+
+        auto new_text = make_unique<const string>(ReadFile(path));
+        SectionBytes new_section_bytes = SplitSections(*new_text);
+        shared_ptr<const Snapshot> old_snapshot = Current();
+
+        auto new_snapshot = make_shared<Snapshot>();
+        size_t reparsed = 0;
+        for (const auto &[name, ranges] : new_section_bytes) {
+            auto old_bytes = section_bytes.find(name);
+            if (old_snapshot && old_bytes != section_bytes.end() && SameBytes(old_bytes->second, ranges)) {
+                new_snapshot->sections[name] = old_snapshot->sections.at(name);
+            } else {
+                new_snapshot->sections[name] = ParseSection(ranges);
+                ++reparsed;
+            }
+        }
+
+        // string_view старых секций указывают в text, поэтому он заменяется последним
+        text = move(new_text);
+        section_bytes = move(new_section_bytes);
+        snapshot.store(move(new_snapshot));
+        version.fetch_add(1, memory_order_release);
+
+        return reparsed;
+    }
+
+    void ReloadableDocument::StartWatching() {
+        if (watcher.joinable()) {
+            return;
+        }
+
+        // Следим за каталогом, а не за файлом: редакторы и деплой обычно
+        // подменяют файл переименованием, и inode файла меняется
+        const size_t slash = path.rfind('/');
+        const string dir = slash == string::npos ? "." : path.substr(0, max<size_t>(slash, 1));
+
+        int inotify_fd = inotify_init1(IN_CLOEXEC);
+        if (inotify_fd < 0) {
+            throw system_error(errno, generic_category(), "inotify_init1");
+        }
+        if (inotify_add_watch(inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            int error = errno;
+            close(inotify_fd);
+            throw system_error(error, generic_category(), "inotify_add_watch " + dir);
+        }
+        if (pipe(wake_pipe) < 0) {
+            int error = errno;
+            close(inotify_fd);
+            throw system_error(error, generic_category(), "pipe");
+        }
+
+        watcher = thread([this, inotify_fd] {
+            Watch(inotify_fd, wake_pipe[0]);
+            close(inotify_fd);
+        });
+    }
+
+    void ReloadableDocument::StopWatching() {
+        if (!watcher.joinable()) {
+            return;
+        }
+        char byte = 0;
+        [[maybe_unused]] ssize_t written = write(wake_pipe[1], &byte, 1);
+        watcher.join();
+        close(wake_pipe[0]);
+        close(wake_pipe[1]);
+        wake_pipe[0] = wake_pipe[1] = -1;
+    }
+
+    void ReloadableDocument::Watch(int inotify_fd, int wake_fd) {
+        const size_t slash = path.rfind('/');
+        const string file_name = slash == string::npos ? path : path.substr(slash + 1);
+
+        alignas(inotify_event) char buffer[4096];
+        pollfd fds[] = {{inotify_fd, POLLIN, 0}, {wake_fd, POLLIN, 0}};
+
+        while (true) {
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return;
+            }
+            if (fds[1].revents != 0) {
+                return;
+            }
+
+            ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+            if (length <= 0) {
+                continue;
+            }
+
+            bool changed = false;
+            for (char *p = buffer; p < buffer + length;) {
+                auto *event = reinterpret_cast<inotify_event *>(p);
+                if (event->len > 0 && file_name == event->name) {
+                    changed = true;
+                }
+                p += sizeof(inotify_event) + event->len;
+            }
+
+            if (changed) {
+                // Недописанный или битый файл не должен ронять сервис:
+                // остаётся предыдущий снимок
+                try {
+                    Reload();
+                } catch (exception &) {
+                }
+            }
+        }
+    }
+
+}
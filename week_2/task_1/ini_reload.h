@@ -0,0 +1,91 @@
+#pragma once
+
+#include "ini.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace Ini {
+
+    // Неизменяемый снимок документа. Секции, байты которых не менялись
+    // между перезагрузками, разделяются соседними снимками.
+    class Snapshot {
+    public:
+        const Section &GetSection(string_view name) const;
+
+        size_t SectionCount() const;
+
+    private:
+        friend class ReloadableDocument;
+
+        StringMap<shared_ptr<const Section>> sections;
+    };
+
+    // Документ, перечитывающий свой файл при изменении. Повторно разбираются
+    // только секции, текст которых изменился; новый снимок публикуется
+    // атомарно, а старые снимки живут, пока на них есть ссылки.
+    class ReloadableDocument {
+    public:
+        // Читатель, кеширующий снимок: пока версия документа не изменилась,
+        // Get() обходится одной атомарной загрузкой без блокировок
+        class Reader {
+        public:
+            explicit Reader(const ReloadableDocument &doc);
+
+            const Snapshot &Get();
+
+        private:
+            const ReloadableDocument &doc;
+            uint64_t version;
+            shared_ptr<const Snapshot> snapshot;
+        };
+
+        explicit ReloadableDocument(string path);
+
+        ~ReloadableDocument();
+
+        ReloadableDocument(const ReloadableDocument &) = delete;
+
+        ReloadableDocument &operator=(const ReloadableDocument &) = delete;
+
+        shared_ptr<const Snapshot> Current() const;
+
+        uint64_t Version() const;
+
+        // Перечитывает файл и возвращает число заново разобранных секций
+        size_t Reload();
+
+        // Запускает фоновый поток, вызывающий Reload() по событиям inotify
+        void StartWatching();
+
+        void StopWatching();
+
+    private:
+        void Watch(int inotify_fd, int wake_fd);
+
+        const string path;
+
+        atomic<shared_ptr<const Snapshot>> snapshot;
+        atomic<uint64_t> version{0};
+
+        // Сериализует только писателей; читатели его не берут
+        mutex reload_mutex;
+        // Текст лежит в куче: string_view из section_bytes должны пережить
+        // перемещение указателя, а короткая строка при перемещении копирует
+        // байты из своего внутреннего буфера
+        unique_ptr<const string> text;
+        unordered_map<string, vector<string_view>> section_bytes;
+
+        thread watcher;
+        int wake_pipe[2] = {-1, -1};
+    };
+
+}
@@ -0,0 +1,102 @@
+#include "ini_save.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+namespace Ini {
+
+    namespace {
+        void CheckSectionName(string_view name, string_view header) {
+            if (name.find('\n') != string_view::npos || ParseSectionName(header) != name) {
+                throw invalid_argument("Ini::Save: section name \"" + string(name) + "\" cannot be saved");
+            }
+        }
+
+        void CheckKeyValue(string_view key, string_view value, string_view line) {
+            if (key.empty() || value.empty() || key.find('=') != string_view::npos
+                || line.find('\n') != string_view::npos || ParseSectionName(line)) {
+                throw invalid_argument("Ini::Save: pair \"" + string(line) + "\" cannot be saved");
+            }
+        }
+
+        size_t RenderedSize(const Document &doc) {
+            size_t size = 0;
+            for (const auto &[name, section] : doc) {
+                size += name.size() + 4;
+                for (const auto &[key, value] : section) {
+                    size += key.size() + value.size() + 2;
+                }
+            }
+            return size;
+        }
+
+        // Указатели на пары имя-значение в порядке вывода
+        template<typename Range>
+        auto Entries(const Range &range, SaveOrder order) {
+            vector<decltype(&*range.begin())> result;
+            for (const auto &entry : range) {
+                result.push_back(&entry);
+            }
+            if (order == SaveOrder::Sorted) {
+                sort(result.begin(), result.end(), [](const auto *lhs, const auto *rhs) {
+                    return lhs->first < rhs->first;
+                });
+            }
+            return result;
+        }
+
+        // Дописывает строку в буфер без перевыделения и возвращает её вид в буфере
+        string_view Append(string &buffer, initializer_list<string_view> parts) {
+            const size_t start = buffer.size();
+            for (string_view part : parts) {
+                buffer.append(part);
+            }
+            return string_view(buffer).substr(start);
+        }
+    }
+
+    string Render(const Document &doc, SaveOrder order) {
+        string buffer;
+        buffer.reserve(RenderedSize(doc));
+
+        for (const auto *section : Entries(doc, order)) {
+            const auto &[name, keys] = *section;
+            CheckSectionName(name, Append(buffer, {"[", string_view(name), "]"}));
+            buffer += '\n';
+
+            for (const auto *entry : Entries(keys, order)) {
+                const auto &[key, value] = *entry;
+                CheckKeyValue(key, value, Append(buffer, {string_view(key), "=", string_view(value)}));
+                buffer += '\n';
+            }
+            buffer += '\n';
+        }
+
+        return buffer;
+    }
+
+    void Save(const Document &doc, int fd, SaveOrder order) {
+        const string buffer = Render(doc, order);
+        for (size_t written = 0; written < buffer.size();) {
+            ssize_t result = write(fd, buffer.data() + written, buffer.size() - written);
+            if (result < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw system_error(errno, generic_category(), "Ini::Save: write");
+            }
+            written += static_cast<size_t>(result);
+        }
+    }
+
+    void Save(const Document &doc, ostream &output, SaveOrder order) {
+        const string buffer = Render(doc, order);
+        output.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+    }
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "ini.h"
+
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace Ini {
+
+    enum class SaveOrder {
+        // Порядок хеш-таблиц: быстрее, но меняется от запуска к запуску
+        Unordered,
+        // Секции и ключи по возрастанию: вывод можно сравнивать diff'ом
+        Sorted,
+    };
+
+    // Формирует весь текст в одном заранее выделенном буфере.
+    // Бросает invalid_argument для пары, которую Load прочитал бы иначе:
+    // пустой ключ или значение, '=' в ключе, перевод строки, строка,
+    // похожая на заголовок секции. Поэтому Load(Render(doc)) == doc.
+    string Render(const Document &doc, SaveOrder order = SaveOrder::Unordered);
+
+    // Пишет Render(doc) одним вызовом write (повторяя его только при частичной записи)
+    void Save(const Document &doc, int fd, SaveOrder order = SaveOrder::Unordered);
+
+    void Save(const Document &doc, ostream &output, SaveOrder order = SaveOrder::Unordered);
+
+}
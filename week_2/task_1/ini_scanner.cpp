@@ -0,0 +1,182 @@
+#include "ini_scanner.h"
+
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace Ini {
+
+    namespace {
+        constexpr size_t BLOCK_SIZE = 64;
+
+        inline size_t LowestBit(uint64_t mask) {
+            return static_cast<size_t>(__builtin_ctzll(mask));
+        }
+
+        // Маска битов строго ниже позиции bit
+        inline uint64_t BitsBelow(size_t bit) {
+            return bit >= 64 ? ~0ULL : (1ULL << bit) - 1;
+        }
+
+#if defined(__AVX2__)
+        inline uint64_t MatchMask(__m256i lo, __m256i hi, char c) {
+            const __m256i needle = _mm256_set1_epi8(c);
+            uint64_t low = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, needle)));
+            uint64_t high = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, needle)));
+            return low | (high << 32);
+        }
+#elif defined(__SSE2__)
+        inline uint64_t MatchMask(const __m128i *chunks, char c) {
+            const __m128i needle = _mm_set1_epi8(c);
+            uint64_t result = 0;
+            for (int i = 0; i < 4; ++i) {
+                uint64_t bits = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunks[i], needle)));
+                result |= bits << (16 * i);
+            }
+            return result;
+        }
+#endif
+    }
+
+    optional<string_view> LineMarks::SectionName() const {
+        if (open_bracket != string_view::npos && close_bracket != string_view::npos
+            && close_bracket - open_bracket > 1) {
+            return line.substr(open_bracket + 1, close_bracket - open_bracket - 1);
+        }
+        return nullopt;
+    }
+
+    pair<string_view, string_view> LineMarks::KeyValue() const {
+        string_view left = line.substr(0, equals);
+
+        if (equals < line.size() && equals + 1 < line.size()) {
+            return {left, line.substr(equals + 1)};
+        } else {
+            return {left, string_view()};
+        }
+    }
+
+    LineScanner::LineScanner(string_view text) : text(text) {
+    }
+
+    const LineScanner::BlockMasks &LineScanner::LoadBlock(size_t base) {
+        if (base == block_base) {
+            return masks;
+        }
+
+        const char *block = text.data() + base;
+        alignas(32) char padded[BLOCK_SIZE];
+        if (text.size() - base < BLOCK_SIZE) {
+            memset(padded, 0, BLOCK_SIZE);
+            memcpy(padded, block, text.size() - base);
+            block = padded;
+        }
+
+#if defined(__AVX2__)
+        const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block));
+        const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + 32));
+        masks.newline = MatchMask(lo, hi, '\n');
+        masks.open_bracket = MatchMask(lo, hi, '[');
+        masks.close_bracket = MatchMask(lo, hi, ']');
+        masks.equals = MatchMask(lo, hi, '=');
+#elif defined(__SSE2__)
+        __m128i chunks[4];
+        for (int i = 0; i < 4; ++i) {
+            chunks[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 16 * i));
+        }
+        masks.newline = MatchMask(chunks, '\n');
+        masks.open_bracket = MatchMask(chunks, '[');
+        masks.close_bracket = MatchMask(chunks, ']');
+        masks.equals = MatchMask(chunks, '=');
+#else
+        masks = {};
+        for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+            const uint64_t bit = 1ULL << i;
+            switch (block[i]) {
+                case '\n':
+                    masks.newline |= bit;
+                    break;
+                case '[':
+                    masks.open_bracket |= bit;
+                    break;
+                case ']':
+                    masks.close_bracket |= bit;
+                    break;
+                case '=':
+                    masks.equals |= bit;
+                    break;
+                default:
+                    break;
+            }
+        }
+#endif
+
+        block_base = base;
+        return masks;
+    }
+
+    bool LineScanner::Next(LineMarks &marks) {
+        if (pos >= text.size()) {
+            return false;
+        }
+
+        const size_t line_start = pos;
+        size_t open_bracket = string_view::npos;
+        size_t close_bracket = string_view::npos;
+        size_t equals = string_view::npos;
+        size_t line_end = text.size();
+
+        for (size_t p = line_start; p < text.size();) {
+            const size_t base = p - p % BLOCK_SIZE;
+            const BlockMasks &block = LoadBlock(base);
+
+            // Рассматриваем только биты от p до конца строки внутри блока
+            uint64_t window = ~BitsBelow(p - base);
+            const uint64_t newline = block.newline & window;
+            if (newline != 0) {
+                window &= BitsBelow(LowestBit(newline));
+            }
+
+            if (open_bracket == string_view::npos) {
+                if (uint64_t m = block.open_bracket & window) {
+                    open_bracket = base + LowestBit(m);
+                }
+            }
+            if (open_bracket != string_view::npos && close_bracket == string_view::npos) {
+                uint64_t m = block.close_bracket & window;
+                if (open_bracket >= base) {
+                    m &= ~BitsBelow(open_bracket - base + 1);
+                }
+                if (m != 0) {
+                    close_bracket = base + LowestBit(m);
+                }
+            }
+            if (equals == string_view::npos) {
+                if (uint64_t m = block.equals & window) {
+                    equals = base + LowestBit(m);
+                }
+            }
+
+            if (newline != 0) {
+                line_end = base + LowestBit(newline);
+                break;
+            }
+            p = base + BLOCK_SIZE;
+        }
+
+        auto relative = [line_start](size_t position) {
+            return position == string_view::npos ? position : position - line_start;
+        };
+
+        marks.line = text.substr(line_start, line_end - line_start);
+        marks.open_bracket = relative(open_bracket);
+        marks.close_bracket = relative(close_bracket);
+        marks.equals = relative(equals);
+
+        pos = line_end + 1;
+        return true;
+    }
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+using namespace std;
+
+namespace Ini {
+
+    // Разметка одной строки: позиции первого '[', первого ']' после него
+    // и первого '='. Отсутствующий символ обозначается string_view::npos.
+    struct LineMarks {
+        string_view line;
+        size_t open_bracket = string_view::npos;
+        size_t close_bracket = string_view::npos;
+        size_t equals = string_view::npos;
+
+        // То же, что ParseSectionName(line), но без повторного прохода по строке
+        optional<string_view> SectionName() const;
+
+        // То же, что Split(line, '='), но без повторного прохода по строке
+        pair<string_view, string_view> KeyValue() const;
+    };
+
+    // Делит текст на строки за один проход. Байты классифицируются блоками
+    // по 64 сразу для '\n', '[', ']' и '=' (AVX2 или SSE2, если доступны,
+    // иначе скалярный цикл), после чего позиции берутся из битовых масок.
+    class LineScanner {
+    public:
+        explicit LineScanner(string_view text);
+
+        bool Next(LineMarks &marks);
+
+    private:
+        struct BlockMasks {
+            uint64_t newline = 0;
+            uint64_t open_bracket = 0;
+            uint64_t close_bracket = 0;
+            uint64_t equals = 0;
+        };
+
+        const BlockMasks &LoadBlock(size_t base);
+
+        string_view text;
+        size_t pos = 0;
+        size_t block_base = string_view::npos;
+        BlockMasks masks;
+    };
+
+}
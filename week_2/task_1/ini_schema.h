@@ -0,0 +1,282 @@
+#pragma once
+
+#include "ini.h"
+
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+namespace Ini {
+
+    // Поле схемы: пара секция/ключ и функция, записывающая разобранное
+    // значение прямо в поле структуры
+    template<typename Struct>
+    struct SchemaField {
+        string_view section;
+        string_view key;
+
+        void (*assign)(Struct &, string_view);
+    };
+
+    struct UnknownEntry {
+        string section;
+        string key;
+        string value;
+    };
+
+    namespace Schemas {
+        template<typename T>
+        struct MemberTraits;
+
+        template<typename S, typename F>
+        struct MemberTraits<F S::*> {
+            using Struct = S;
+            using Field = F;
+        };
+
+        template<typename T>
+        void ParseField(string_view raw, T &field) {
+            if constexpr (is_same_v<T, string>) {
+                field = string(raw);
+            } else if constexpr (is_same_v<T, bool>) {
+                if (raw == "true" || raw == "yes" || raw == "on" || raw == "1") {
+                    field = true;
+                } else if (raw == "false" || raw == "no" || raw == "off" || raw == "0") {
+                    field = false;
+                } else {
+                    throw invalid_argument("Ini::LoadWithSchema: \"" + string(raw) + "\" is not a boolean");
+                }
+            } else {
+                static_assert(is_arithmetic_v<T>, "Ini::Bind: unsupported field type");
+                auto [ptr, ec] = from_chars(raw.data(), raw.data() + raw.size(), field);
+                if (ec != errc{} || ptr != raw.data() + raw.size()) {
+                    throw invalid_argument("Ini::LoadWithSchema: \"" + string(raw) + "\" is not a number");
+                }
+            }
+        }
+
+        // FNV-1a по секции и ключу с разделителем между ними
+        constexpr uint64_t Hash(string_view section, string_view key) {
+            uint64_t hash = 14695981039346656037ULL;
+            for (char c : section) {
+                hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+            }
+            hash = (hash ^ 0xffu) * 1099511628211ULL;
+            for (char c : key) {
+                hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+            }
+            return hash;
+        }
+
+        // Финализатор splitmix64: второй уровень хеша для выбранного смещения
+        constexpr uint64_t Mix(uint64_t hash, uint64_t displacement) {
+            uint64_t z = hash + displacement * 0x9e3779b97f4a7c15ULL;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+
+        constexpr size_t TableSize(size_t field_count) {
+            size_t size = 1;
+            while (size < field_count * 2) {
+                size *= 2;
+            }
+            return size;
+        }
+    }
+
+    template<auto Member>
+    constexpr auto Bind(string_view section, string_view key) {
+        using Struct = typename Schemas::MemberTraits<decltype(Member)>::Struct;
+        return SchemaField<Struct>{section, key, [](Struct &s, string_view raw) {
+            Schemas::ParseField(raw, s.*Member);
+        }};
+    }
+
+    // Схема, известная на этапе компиляции. Конструктор строит
+    // идеальную хеш-функцию методом hash-and-displace: ключи раскладываются
+    // по N корзинам, и для каждой корзины подбирается смещение, при котором
+    // её ключи попадают в свободные слоты таблицы размера не меньше 2N.
+    template<typename Struct, size_t N>
+    class Schema {
+        // Корзин столько же, сколько полей, и без полей hash % N делит на ноль
+        static_assert(N > 0, "Ini::Schema needs at least one field");
+
+    public:
+        static constexpr size_t TABLE_SIZE = Schemas::TableSize(N);
+        static constexpr size_t NOT_FOUND = N;
+
+        constexpr explicit Schema(const SchemaField<Struct> (&fields)[N]) {
+            for (size_t i = 0; i < N; ++i) {
+                this->fields[i] = fields[i];
+                hashes[i] = Schemas::Hash(fields[i].section, fields[i].key);
+            }
+            CheckHashes();
+            BuildTable();
+        }
+
+        // Индекс поля или NOT_FOUND; стоит одного прохода по байтам имени
+        constexpr size_t Find(string_view section, string_view key) const {
+            const uint64_t hash = Schemas::Hash(section, key);
+            const size_t slot = Schemas::Mix(hash, displacements[hash % N]) & (TABLE_SIZE - 1);
+            const size_t index = table[slot];
+            if (index != NOT_FOUND && hashes[index] == hash
+                && fields[index].section == section && fields[index].key == key) {
+                return index;
+            }
+            return NOT_FOUND;
+        }
+
+        constexpr const SchemaField<Struct> &Field(size_t index) const {
+            return fields[index];
+        }
+
+    private:
+        // Два поля с одинаковым хешем попадают в один слот при любом
+        // смещении, и подбор в BuildTable не закончился бы. В constexpr
+        // контексте throw превращается в ошибку компиляции.
+        constexpr void CheckHashes() const {
+            for (size_t i = 0; i < N; ++i) {
+                for (size_t j = 0; j < i; ++j) {
+                    if (hashes[i] != hashes[j]) {
+                        continue;
+                    }
+                    if (fields[i].section == fields[j].section && fields[i].key == fields[j].key) {
+                        throw invalid_argument("Ini::Schema: duplicate section/key pair");
+                    }
+                    throw invalid_argument("Ini::Schema: hash collision between fields");
+                }
+            }
+        }
+
+        constexpr void BuildTable() {
+            for (size_t &index : table) {
+                index = NOT_FOUND;
+            }
+
+            array<size_t, N> bucket_sizes{};
+            for (size_t i = 0; i < N; ++i) {
+                ++bucket_sizes[hashes[i] % N];
+            }
+
+            // Сначала размещаются самые большие корзины, пока таблица пуста
+            array<size_t, N> order{};
+            for (size_t i = 0; i < N; ++i) {
+                order[i] = i;
+            }
+            for (size_t i = 1; i < N; ++i) {
+                for (size_t j = i; j > 0 && bucket_sizes[order[j]] > bucket_sizes[order[j - 1]]; --j) {
+                    swap(order[j], order[j - 1]);
+                }
+            }
+
+            for (size_t bucket : order) {
+                if (bucket_sizes[bucket] == 0) {
+                    break;
+                }
+                for (uint64_t displacement = 0;; ++displacement) {
+                    if (TryPlace(bucket, displacement)) {
+                        displacements[bucket] = displacement;
+                        break;
+                    }
+                }
+            }
+        }
+
+        constexpr bool TryPlace(size_t bucket, uint64_t displacement) {
+            array<size_t, N> slots{};
+            size_t count = 0;
+            for (size_t i = 0; i < N; ++i) {
+                if (hashes[i] % N != bucket) {
+                    continue;
+                }
+                const size_t slot = Schemas::Mix(hashes[i], displacement) & (TABLE_SIZE - 1);
+                if (table[slot] != NOT_FOUND) {
+                    return false;
+                }
+                for (size_t j = 0; j < count; ++j) {
+                    if (slots[j] == slot) {
+                        return false;
+                    }
+                }
+                slots[count++] = slot;
+            }
+
+            count = 0;
+            for (size_t i = 0; i < N; ++i) {
+                if (hashes[i] % N == bucket) {
+                    table[slots[count++]] = i;
+                }
+            }
+            return true;
+        }
+
+        array<SchemaField<Struct>, N> fields{};
+        array<uint64_t, N> hashes{};
+        array<uint64_t, N> displacements{};
+        array<size_t, TABLE_SIZE> table{};
+    };
+
+    template<typename Struct, size_t N>
+    Schema(const SchemaField<Struct> (&fields)[N]) -> Schema<Struct, N>;
+
+    namespace Schemas {
+        template<typename Struct, size_t N>
+        class SchemaVisitor : public Visitor {
+        public:
+            SchemaVisitor(const Schema<Struct, N> &schema, Struct &result, vector<UnknownEntry> &unknown)
+                    : schema(schema), result(result), unknown(unknown) {
+            }
+
+            bool OnSection(string_view name) override {
+                section = name;
+                return true;
+            }
+
+            // Как и в Load, при повторе ключа побеждает первое значение
+            bool OnKeyValue(string_view key, string_view value) override {
+                const size_t index = schema.Find(section, key);
+                if (index == schema.NOT_FOUND) {
+                    unknown.push_back({string(section), string(key), string(value)});
+                } else if (!assigned[index]) {
+                    schema.Field(index).assign(result, value);
+                    assigned[index] = true;
+                }
+                return true;
+            }
+
+        private:
+            const Schema<Struct, N> &schema;
+            Struct &result;
+            vector<UnknownEntry> &unknown;
+            string section;
+            array<bool, N> assigned{};
+        };
+    }
+
+    // Записывает значения известных полей в result и возвращает
+    // пары, которых нет в схеме. Поля, отсутствующие в тексте, не трогаются.
+    template<typename Struct, size_t N>
+    vector<UnknownEntry> LoadWithSchema(string_view text, const Schema<Struct, N> &schema, Struct &result) {
+        vector<UnknownEntry> unknown;
+        Schemas::SchemaVisitor<Struct, N> visitor(schema, result, unknown);
+        Parse(text, visitor);
+        return unknown;
+    }
+
+    template<typename Struct, size_t N>
+    vector<UnknownEntry> LoadWithSchema(istream &input, const Schema<Struct, N> &schema, Struct &result) {
+        vector<UnknownEntry> unknown;
+        Schemas::SchemaVisitor<Struct, N> visitor(schema, result, unknown);
+        Parse(input, visitor);
+        return unknown;
+    }
+
+}
@@ -0,0 +1,119 @@
+#include "ini_typed.h"
+
+#include <charconv>
+#include <stdexcept>
+
+namespace Ini {
+
+    namespace {
+        [[noreturn]] void ThrowBadValue(string_view key, string_view raw, const char *type) {
+            throw invalid_argument("Ini::TypedSection: value \"" + string(raw) + "\" of key \""
+                                   + string(key) + "\" is not " + type);
+        }
+
+        template<typename T>
+        bool ParseNumber(string_view raw, T &result, size_t &consumed) {
+            auto [ptr, ec] = from_chars(raw.data(), raw.data() + raw.size(), result);
+            consumed = ptr - raw.data();
+            return ec == errc{} && consumed > 0;
+        }
+
+        template<typename T>
+        bool ParseWhole(string_view raw, T &result) {
+            size_t consumed = 0;
+            return ParseNumber(raw, result, consumed) && consumed == raw.size();
+        }
+    }
+
+    TypedSection::TypedSection(const Section &section) : section(section) {
+    }
+
+    TypedSection::CachedValue &TypedSection::Lookup(string_view key, CachedKind kind, string_view &raw) const {
+        auto it = cache.find(key);
+        if (it != cache.end() && (it->second.kinds & kind)) {
+            return it->second;
+        }
+
+        auto section_it = section.find(key);
+        if (section_it == section.end()) {
+            throw out_of_range("Ini::TypedSection: unknown key \"" + string(key) + "\"");
+        }
+        raw = section_it->second;
+        if (it == cache.end()) {
+            it = cache.emplace(section_it->first, CachedValue{}).first;
+        }
+        return it->second;
+    }
+
+    int64_t TypedSection::GetInt(string_view key) const {
+        string_view raw;
+        CachedValue &cached = Lookup(key, INT, raw);
+        if (!(cached.kinds & INT)) {
+            if (!ParseWhole(raw, cached.int_value)) {
+                ThrowBadValue(key, raw, "an integer");
+            }
+            cached.kinds |= INT;
+        }
+        return cached.int_value;
+    }
+
+    double TypedSection::GetDouble(string_view key) const {
+        string_view raw;
+        CachedValue &cached = Lookup(key, DOUBLE, raw);
+        if (!(cached.kinds & DOUBLE)) {
+            if (!ParseWhole(raw, cached.double_value)) {
+                ThrowBadValue(key, raw, "a number");
+            }
+            cached.kinds |= DOUBLE;
+        }
+        return cached.double_value;
+    }
+
+    bool TypedSection::GetBool(string_view key) const {
+        string_view raw;
+        CachedValue &cached = Lookup(key, BOOL, raw);
+        if (!(cached.kinds & BOOL)) {
+            if (raw == "true" || raw == "yes" || raw == "on" || raw == "1") {
+                cached.bool_value = true;
+            } else if (raw == "false" || raw == "no" || raw == "off" || raw == "0") {
+                cached.bool_value = false;
+            } else {
+                ThrowBadValue(key, raw, "a boolean");
+            }
+            cached.kinds |= BOOL;
+        }
+        return cached.bool_value;
+    }
+
+    chrono::nanoseconds TypedSection::GetDuration(string_view key) const {
+        string_view raw;
+        CachedValue &cached = Lookup(key, DURATION, raw);
+        if (!(cached.kinds & DURATION)) {
+            int64_t count = 0;
+            size_t consumed = 0;
+            if (!ParseNumber(raw, count, consumed)) {
+                ThrowBadValue(key, raw, "a duration");
+            }
+
+            const string_view unit = raw.substr(consumed);
+            if (unit == "ns") {
+                cached.duration_value = chrono::nanoseconds(count);
+            } else if (unit == "us") {
+                cached.duration_value = chrono::microseconds(count);
+            } else if (unit == "ms") {
+                cached.duration_value = chrono::milliseconds(count);
+            } else if (unit == "s") {
+                cached.duration_value = chrono::seconds(count);
+            } else if (unit == "m") {
+                cached.duration_value = chrono::minutes(count);
+            } else if (unit == "h") {
+                cached.duration_value = chrono::hours(count);
+            } else {
+                ThrowBadValue(key, raw, "a duration");
+            }
+            cached.kinds |= DURATION;
+        }
+        return cached.duration_value;
+    }
+
+}
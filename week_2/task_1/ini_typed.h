@@ -0,0 +1,57 @@
+#pragma once
+
+#include "ini.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using namespace std;
+
+namespace Ini {
+
+    // Типизированный доступ к секции. Результат разбора запоминается для
+    // каждого ключа, и повторное чтение стоит одного поиска в хеш-таблице.
+    // Секция не должна меняться, пока жив TypedSection. Не потокобезопасен.
+    class TypedSection {
+    public:
+        explicit TypedSection(const Section &section);
+
+        // Бросают out_of_range для отсутствующего ключа
+        // и invalid_argument для значения, которое не удалось разобрать
+        int64_t GetInt(string_view key) const;
+
+        double GetDouble(string_view key) const;
+
+        // true/false, yes/no, on/off, 1/0
+        bool GetBool(string_view key) const;
+
+        // Целое число с единицей измерения: ns, us, ms, s, m, h
+        chrono::nanoseconds GetDuration(string_view key) const;
+
+    private:
+        enum CachedKind : uint8_t {
+            INT = 1 << 0,
+            DOUBLE = 1 << 1,
+            BOOL = 1 << 2,
+            DURATION = 1 << 3,
+        };
+
+        struct CachedValue {
+            uint8_t kinds = 0;
+            bool bool_value = false;
+            int64_t int_value = 0;
+            double double_value = 0;
+            chrono::nanoseconds duration_value{0};
+        };
+
+        // Ключ кеша указывает на строку ключа внутри самой секции
+        CachedValue &Lookup(string_view key, CachedKind kind, string_view &raw) const;
+
+        const Section &section;
+        mutable unordered_map<string_view, CachedValue> cache;
+    };
+
+}
@@ -1,8 +1,27 @@
 #include "test_runner.h"
 
 #include "ini.h"
+#include "ini_compiled.h"
+#include "ini_flat.h"
+#include "ini_mapped.h"
+#include "ini_overlay.h"
+#include "ini_parallel.h"
+#include "ini_reload.h"
+#include "ini_save.h"
+#include "ini_scanner.h"
+#include "ini_schema.h"
+#include "ini_typed.h"
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
 #include <sstream>
+#include <thread>
 
 using namespace std;
 
@@ -111,11 +130,547 @@ void TestDuplicateSections() {
     ASSERT_EQUAL(doc.GetSection("one"), expected);
 }
 
+string WriteTempFile(const string &name, const string &content) {
+    const string path = (filesystem::temp_directory_path() / name).string();
+    ofstream(path, ios::binary) << content;
+    return path;
+}
+
+string ReadFileBytes(const string &path) {
+    ifstream input(path, ios::binary);
+    return {istreambuf_iterator<char>(input), istreambuf_iterator<char>()};
+}
+
+void TestLoadFile() {
+    const string text = R"([july]
+food=2500
+sport=12000
+food=1
+
+[august]
+food=3250
+travel=0
+[july]
+clothes=5200
+)";
+    const string path = WriteTempFile("ini_test_load_file.ini", text);
+    const Ini::MappedDocument doc = Ini::LoadFile(path);
+    remove(path.c_str());
+
+    istringstream input(text);
+    const Ini::Document expected = Ini::Load(input);
+
+    ASSERT_EQUAL(doc.SectionCount(), expected.SectionCount());
+    for (const string name : {"july", "august"}) {
+        const Ini::MappedSection &section = doc.GetSection(name);
+        const Ini::Section &expected_section = expected.GetSection(name);
+        ASSERT_EQUAL(section.size(), expected_section.size());
+        for (const auto &[key, value] : expected_section) {
+            ASSERT_EQUAL(section.at(key), value);
+        }
+    }
+    ASSERT(!doc.GetSection("july").Find("jewelery"));
+    ASSERT(doc.FindSection("september") == nullptr);
+}
+
+void TestLoadParallel() {
+    string text = "food=0\n";
+    for (int i = 0; i < 200; ++i) {
+        text += "[section_" + to_string(i % 37) + "]\n";
+        for (int j = 0; j < 5; ++j) {
+            text += "key_" + to_string((i + j) % 11) + "=" + to_string(i * j) + "\n";
+        }
+        text += "\n";
+    }
+
+    istringstream input(text);
+    const Ini::Document expected = Ini::Load(input);
+
+    for (size_t thread_count : {1, 2, 3, 8, 500}) {
+        const Ini::Document doc = Ini::LoadParallel(text, thread_count);
+        ASSERT_EQUAL(doc.SectionCount(), expected.SectionCount());
+        for (int i = 0; i < 37; ++i) {
+            const string name = "section_" + to_string(i);
+            ASSERT_EQUAL(doc.GetSection(name), expected.GetSection(name));
+        }
+    }
+
+    ASSERT_EQUAL(Ini::LoadParallel("", 4).SectionCount(), 0u);
+}
+
+void TestLineScanner() {
+    const string long_key(100, 'k');
+    const string long_value(70, 'v');
+    const vector<string> lines = {
+            "[july]",
+            "",
+            "food=2500",
+            "x[a]=b",
+            "=value",
+            "key=",
+            "a=b=c",
+            "[]",
+            "]x[y",
+            "  [padded]  ",
+            long_key + "=" + long_value,
+            "[" + long_key + "]" + long_value,
+            "[" + long_key,
+            "tail=no newline",
+    };
+
+    string text;
+    for (const string &line : lines) {
+        text += line + "\n";
+    }
+    text.pop_back();
+
+    Ini::LineScanner scanner(text);
+    Ini::LineMarks marks;
+    for (const string &line : lines) {
+        ASSERT(scanner.Next(marks));
+        ASSERT_EQUAL(marks.line, line);
+        ASSERT(marks.SectionName() == Ini::ParseSectionName(line));
+        ASSERT(marks.KeyValue() == Ini::Split(line, '='));
+    }
+    ASSERT(!scanner.Next(marks));
+
+    istringstream input(text);
+    const Ini::Document expected = Ini::Load(input);
+    const Ini::Document doc = Ini::Load(string_view(text));
+    ASSERT_EQUAL(doc.SectionCount(), expected.SectionCount());
+    ASSERT_EQUAL(doc.GetSection("july"), expected.GetSection("july"));
+    ASSERT_EQUAL(doc.GetSection(long_key), expected.GetSection(long_key));
+}
+
+void TestLoadFlat() {
+    string text;
+    for (int i = 0; i < 300; ++i) {
+        text += "[section_" + to_string(i % 50) + "]\n";
+        for (int j = 0; j < 30; ++j) {
+            text += "key_" + to_string((i + j) % 40) + "=" + string(j % 20, 'v') + to_string(i) + "\n";
+        }
+    }
+
+    istringstream input(text);
+    const Ini::Document expected = Ini::Load(input);
+    const Ini::FlatDocument doc = Ini::LoadFlat(string_view(text));
+
+    ASSERT_EQUAL(doc.SectionCount(), expected.SectionCount());
+    for (int i = 0; i < 50; ++i) {
+        const string name = "section_" + to_string(i);
+        const Ini::FlatSection &section = doc.GetSection(name);
+        const Ini::Section &expected_section = expected.GetSection(name);
+        ASSERT_EQUAL(section.size(), expected_section.size());
+        for (const auto &[key, value] : expected_section) {
+            ASSERT_EQUAL(section.at(key), value);
+        }
+        ASSERT(!section.Find("missing"));
+    }
+
+    try {
+        doc.GetSection("missing");
+        Assert(false, "Ini::FlatDocument::GetSection() should throw std::out_of_range for unknown section");
+    } catch (out_of_range &) {
+    }
+    ASSERT(doc.FindSection("missing") == nullptr);
+    ASSERT_EQUAL(doc.FindSection("section_7"), &doc.GetSection("section_7"));
+
+    Ini::FlatDocument manual;
+    Ini::FlatSection &one = manual.AddSection("one");
+    ASSERT(manual.Insert(one, "key", "first"));
+    ASSERT(!manual.Insert(manual.AddSection("one"), "key", "second"));
+    ASSERT_EQUAL(manual.GetSection("one").at("key"), "first");
+    ASSERT_EQUAL(manual.SectionCount(), 1u);
+}
+
+void TestReloadableDocument() {
+    const string path = WriteTempFile("ini_test_reload.ini", "[july]\nfood=2500\n[august]\nfood=3250\n");
+    Ini::ReloadableDocument doc(path);
+    Ini::ReloadableDocument::Reader reader(doc);
+
+    const auto first = doc.Current();
+    ASSERT_EQUAL(first->SectionCount(), 2u);
+    ASSERT_EQUAL(reader.Get().GetSection("july").at("food"), "2500");
+
+    WriteTempFile("ini_test_reload.ini", "[july]\nfood=2500\n[august]\nfood=1\n[september]\nfood=7\n");
+    ASSERT_EQUAL(doc.Reload(), 2u);
+
+    const auto second = doc.Current();
+    ASSERT_EQUAL(second->SectionCount(), 3u);
+    ASSERT_EQUAL(&second->GetSection("july"), &first->GetSection("july"));
+    ASSERT_EQUAL(second->GetSection("august").at("food"), "1");
+    ASSERT_EQUAL(first->GetSection("august").at("food"), "3250");
+    ASSERT_EQUAL(reader.Get().GetSection("september").at("food"), "7");
+
+    doc.StartWatching();
+    const uint64_t version = doc.Version();
+    WriteTempFile("ini_test_reload.ini", "[july]\nfood=0\n");
+    for (int i = 0; i < 200 && doc.Version() == version; ++i) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    doc.StopWatching();
+    remove(path.c_str());
+
+    ASSERT_EQUAL(reader.Get().SectionCount(), 1u);
+    ASSERT_EQUAL(reader.Get().GetSection("july").at("food"), "0");
+}
+
+// Короткий текст помещается во внутренний буфер строки, и сохранённые
+// байты секций не должны указывать в него после перемещения
+void TestReloadSmallFile() {
+    const string path = WriteTempFile("ini_test_reload_small.ini", "[a]\nk=v\n");
+    Ini::ReloadableDocument doc(path);
+
+    WriteTempFile("ini_test_reload_small.ini", "[a]\nk=w\n");
+    ASSERT_EQUAL(doc.Reload(), 1u);
+    ASSERT_EQUAL(doc.Current()->GetSection("a").at("k"), "w");
+
+    ASSERT_EQUAL(doc.Reload(), 0u);
+    WriteTempFile("ini_test_reload_small.ini", "[a]\nk=x\n");
+    ASSERT_EQUAL(doc.Reload(), 1u);
+    ASSERT_EQUAL(doc.Current()->GetSection("a").at("k"), "x");
+    remove(path.c_str());
+}
+
+void TestCompiled() {
+    string text;
+    for (int i = 0; i < 100; ++i) {
+        text += "[section_" + to_string(i) + "]\n";
+        for (int j = 0; j < i % 13; ++j) {
+            text += "key_" + to_string(j) + "=" + to_string(i * j) + "\n";
+        }
+    }
+    const Ini::Document expected = Ini::Load(string_view(text));
+
+    const string path = (filesystem::temp_directory_path() / "ini_test_compiled.bin").string();
+    Ini::Compile(expected, path);
+    const Ini::CompiledDocument doc = Ini::OpenCompiled(path);
+
+    ASSERT_EQUAL(doc.SectionCount(), expected.SectionCount());
+    for (const auto &[name, expected_section] : expected) {
+        const Ini::CompiledSection section = doc.GetSection(name);
+        ASSERT_EQUAL(section.size(), expected_section.size());
+        for (const auto &[key, value] : expected_section) {
+            ASSERT_EQUAL(section.at(key), value);
+        }
+        ASSERT(!section.Find("missing"));
+    }
+
+    try {
+        doc.GetSection("missing");
+        Assert(false, "Ini::CompiledDocument::GetSection() should throw std::out_of_range for unknown section");
+    } catch (out_of_range &) {
+    }
+    ASSERT(!doc.FindSection("missing"));
+    ASSERT_EQUAL(doc.FindSection("section_12")->size(), 12u);
+
+    // Испорченные поля таблицы секций и слотов ловятся, а не читаются за пределами образа
+    const string image = ReadFileBytes(path);
+    auto corrupted = [&image](size_t offset, uint64_t value) {
+        string result = image;
+        memcpy(result.data() + offset, &value, sizeof(value));
+        return result;
+    };
+    Ini::Compiled::Header header;
+    memcpy(&header, image.data(), sizeof(header));
+    const size_t first_entry = header.sections_offset;
+    const vector<string> bad_headers = {
+            image.substr(0, image.size() - 1),
+            corrupted(offsetof(Ini::Compiled::Header, slot_count), UINT64_MAX / 8),
+    };
+    for (const string &bad : bad_headers) {
+        WriteTempFile("ini_test_compiled.bin", bad);
+        try {
+            Ini::OpenCompiled(path);
+            Assert(false, "Ini::OpenCompiled() should reject a corrupted image");
+        } catch (runtime_error &) {
+        }
+    }
+
+    // Записи секций и слоты проверяются при поиске; у первой по имени секции
+    // section_0 нет ключей и единственный слот
+    const vector<string> bad_tables = {
+            corrupted(first_entry + offsetof(Ini::Compiled::SectionEntry, name_offset), UINT64_MAX - 2),
+            corrupted(first_entry + offsetof(Ini::Compiled::SectionEntry, first_slot), header.slot_count),
+            corrupted(first_entry + offsetof(Ini::Compiled::SectionEntry, slot_count), 3),
+            corrupted(header.slots_offset, header.file_size),
+    };
+    for (const string &bad : bad_tables) {
+        WriteTempFile("ini_test_compiled.bin", bad);
+        const Ini::CompiledDocument bad_doc = Ini::OpenCompiled(path);
+        try {
+            bad_doc.GetSection("section_0").Find("key");
+            Assert(false, "Ini::CompiledDocument should reject a corrupted section on lookup");
+        } catch (runtime_error &) {
+        }
+    }
+
+    WriteTempFile("ini_test_compiled.bin", text);
+    try {
+        Ini::OpenCompiled(path);
+        Assert(false, "Ini::OpenCompiled() should reject text files");
+    } catch (runtime_error &) {
+    }
+    remove(path.c_str());
+}
+
+class FindValueVisitor : public Ini::Visitor {
+public:
+    FindValueVisitor(string_view section, string_view key) : section(section), key(key) {
+    }
+
+    bool OnSection(string_view name) override {
+        ++sections_seen;
+        in_target = name == section;
+        return true;
+    }
+
+    bool OnKeyValue(string_view k, string_view v) override {
+        if (in_target && k == key) {
+            value = string(v);
+            return false;
+        }
+        return true;
+    }
+
+    string_view section;
+    string_view key;
+    bool in_target = false;
+    int sections_seen = 0;
+    optional<string> value;
+};
+
+void TestParseVisitor() {
+    const string text = "orphan=1\n[july]\nfood=2500\n[august]\nempty=\ntravel=0\n[september]\ntravel=5\n";
+
+    for (bool from_stream : {false, true}) {
+        FindValueVisitor visitor("august", "travel");
+        if (from_stream) {
+            istringstream input(text);
+            Ini::Parse(input, visitor);
+        } else {
+            Ini::Parse(string_view(text), visitor);
+        }
+        ASSERT(visitor.value == optional<string>("0"));
+        ASSERT_EQUAL(visitor.sections_seen, 2);
+    }
+
+    FindValueVisitor orphan("", "orphan");
+    Ini::Parse(string_view(text), orphan);
+    ASSERT(!orphan.value);
+    ASSERT_EQUAL(orphan.sections_seen, 3);
+}
+
+void TestTypedSection() {
+    const Ini::Section section = {
+            {"food",    "2500"},
+            {"rate",    "0.25"},
+            {"enabled", "yes"},
+            {"timeout", "250ms"},
+            {"period",  "2h"},
+            {"broken",  "12abc"},
+    };
+    const Ini::TypedSection typed(section);
+
+    ASSERT_EQUAL(typed.GetInt("food"), 2500);
+    ASSERT_EQUAL(typed.GetInt("food"), 2500);
+    ASSERT_EQUAL(typed.GetDouble("food"), 2500.0);
+    ASSERT_EQUAL(typed.GetDouble("rate"), 0.25);
+    ASSERT_EQUAL(typed.GetBool("enabled"), true);
+    ASSERT(typed.GetDuration("timeout") == chrono::milliseconds(250));
+    ASSERT(typed.GetDuration("period") == chrono::hours(2));
+
+    try {
+        typed.GetInt("broken");
+        Assert(false, "Ini::TypedSection::GetInt() should throw std::invalid_argument for malformed value");
+    } catch (invalid_argument &) {
+    }
+    try {
+        typed.GetInt("missing");
+        Assert(false, "Ini::TypedSection::GetInt() should throw std::out_of_range for unknown key");
+    } catch (out_of_range &) {
+    }
+    try {
+        typed.GetBool("food");
+        Assert(false, "Ini::TypedSection::GetBool() should throw std::invalid_argument for non-boolean value");
+    } catch (invalid_argument &) {
+    }
+}
+
+void TestStringViewLookup() {
+    const string text = "[july]\nfood=2500\n[august]\ntravel=0\n";
+    const Ini::Document doc = Ini::Load(string_view(text));
+
+    const string_view july = string_view(text).substr(1, 4);
+    const string_view food = string_view(text).substr(7, 4);
+    ASSERT_EQUAL(doc.GetSection(july).at("food"), "2500");
+    ASSERT_EQUAL(doc.FindSection(july), &doc.GetSection("july"));
+    ASSERT(doc.FindSection("september") == nullptr);
+
+    ASSERT_EQUAL(*doc.FindValue(july, food), "2500");
+    ASSERT(doc.FindValue(july, "travel") == nullptr);
+    ASSERT(doc.FindValue("september", food) == nullptr);
+    ASSERT_EQUAL(*Ini::FindValue(doc.GetSection("august"), string_view("travel")), "0");
+}
+
+struct Ledger {
+    int july_food = 0;
+    int july_sport = 0;
+    int july_travel = 0;
+    int july_clothes = 0;
+    int august_food = 0;
+    int august_sport = 0;
+    int august_travel = 0;
+    int august_clothes = 0;
+    double august_jewelery = 0;
+};
+
+constexpr Ini::Schema LEDGER_SCHEMA({
+        Ini::Bind<&Ledger::july_food>("july", "food"),
+        Ini::Bind<&Ledger::july_sport>("july", "sport"),
+        Ini::Bind<&Ledger::july_travel>("july", "travel"),
+        Ini::Bind<&Ledger::july_clothes>("july", "clothes"),
+        Ini::Bind<&Ledger::august_food>("august", "food"),
+        Ini::Bind<&Ledger::august_sport>("august", "sport"),
+        Ini::Bind<&Ledger::august_travel>("august", "travel"),
+        Ini::Bind<&Ledger::august_clothes>("august", "clothes"),
+        Ini::Bind<&Ledger::august_jewelery>("august", "jewelery"),
+});
+
+static_assert(LEDGER_SCHEMA.Find("august", "clothes") == 7);
+static_assert(LEDGER_SCHEMA.Find("july", "jewelery") == LEDGER_SCHEMA.NOT_FOUND);
+
+void TestLoadWithSchema() {
+    istringstream input(
+            R"([july]
+food=2500
+sport=12000
+travel=23400
+clothes=5200
+food=1
+
+[august]
+food=3250
+sport=10000
+travel=0
+clothes=8300
+jewelery=25000.5
+gifts=700
+)"
+    );
+
+    Ledger ledger;
+    const vector<Ini::UnknownEntry> unknown = Ini::LoadWithSchema(input, LEDGER_SCHEMA, ledger);
+
+    ASSERT_EQUAL(ledger.july_food, 2500);
+    ASSERT_EQUAL(ledger.july_clothes, 5200);
+    ASSERT_EQUAL(ledger.august_travel, 0);
+    ASSERT_EQUAL(ledger.august_clothes, 8300);
+    ASSERT_EQUAL(ledger.august_jewelery, 25000.5);
+    ASSERT_EQUAL(unknown.size(), 1u);
+    ASSERT_EQUAL(unknown[0].section, "august");
+    ASSERT_EQUAL(unknown[0].key, "gifts");
+    ASSERT_EQUAL(unknown[0].value, "700");
+
+    for (size_t i = 0; i < 9; ++i) {
+        const auto &field = LEDGER_SCHEMA.Field(i);
+        ASSERT_EQUAL(LEDGER_SCHEMA.Find(field.section, field.key), i);
+    }
+
+    try {
+        Ini::LoadWithSchema(string_view("[july]\nfood=lots\n"), LEDGER_SCHEMA, ledger);
+        Assert(false, "Ini::LoadWithSchema() should throw std::invalid_argument for malformed value");
+    } catch (invalid_argument &) {
+    }
+
+    try {
+        Ini::Schema duplicated({
+                Ini::Bind<&Ledger::july_food>("july", "food"),
+                Ini::Bind<&Ledger::july_sport>("july", "food"),
+        });
+        Assert(false, "Ini::Schema should throw std::invalid_argument for duplicate section/key pair");
+    } catch (invalid_argument &) {
+    }
+}
+
+void TestOverlayDocument() {
+    auto base = make_shared<const Ini::Document>(
+            Ini::Load(string_view("[july]\nfood=2500\nsport=12000\n[august]\nfood=3250\n"))
+    );
+
+    Ini::OverlayDocument host(base, Ini::Load(string_view("[july]\nfood=100\n[september]\nfood=7\n")));
+    host.Set("august", "travel", "0");
+    host.Set("october", "food", "1");
+    host.Set("october", "sport", "2");
+
+    ASSERT_EQUAL(host.GetValue("july", "food"), "100");
+    ASSERT_EQUAL(host.GetValue("july", "sport"), "12000");
+    ASSERT_EQUAL(host.GetValue("august", "food"), "3250");
+    ASSERT_EQUAL(host.GetValue("august", "travel"), "0");
+    ASSERT_EQUAL(host.GetValue("september", "food"), "7");
+    ASSERT(host.FindValue("july", "travel") == nullptr);
+    ASSERT(host.HasSection("october"));
+    ASSERT(!host.HasSection("november"));
+    ASSERT_EQUAL(host.SectionCount(), 4u);
+
+    const Ini::Section expected_july = {{"food", "100"}, {"sport", "12000"}};
+    ASSERT_EQUAL(host.MaterializeSection("july"), expected_july);
+
+    ASSERT_EQUAL(base->GetSection("july").at("food"), "2500");
+    ASSERT_EQUAL(&host.Base(), base.get());
+    ASSERT_EQUAL(host.Overrides().SectionCount(), 4u);
+}
+
+void TestSave() {
+    const string text = "[july]\nfood=2500\nsport=12000\nnote=a=b\n[august]\nfood=3250\n[empty]\n[x[y]\nkey=]v[\n";
+    const Ini::Document doc = Ini::Load(string_view(text));
+
+    for (auto order : {Ini::SaveOrder::Unordered, Ini::SaveOrder::Sorted}) {
+        const Ini::Document loaded = Ini::Load(string_view(Ini::Render(doc, order)));
+        ASSERT_EQUAL(loaded.SectionCount(), doc.SectionCount());
+        for (const auto &[name, section] : doc) {
+            ASSERT_EQUAL(loaded.GetSection(name), section);
+        }
+    }
+
+    ASSERT_EQUAL(
+            Ini::Render(doc, Ini::SaveOrder::Sorted),
+            "[august]\nfood=3250\n\n[empty]\n\n[july]\nfood=2500\nnote=a=b\nsport=12000\n\n[x[y]\nkey=]v[\n\n"
+    );
+
+    ostringstream output;
+    Ini::Save(doc, output, Ini::SaveOrder::Sorted);
+    ASSERT_EQUAL(output.str(), Ini::Render(doc, Ini::SaveOrder::Sorted));
+
+    for (const auto &[key, value] : vector<pair<string, string>>{{"a=b", "1"}, {"k", "[v]"}, {"k", "multi\nline"}}) {
+        Ini::Document bad;
+        bad.AddSection("section").insert({key, value});
+        try {
+            Ini::Render(bad);
+            Assert(false, "Ini::Render() should reject pair " + key + "=" + value);
+        } catch (invalid_argument &) {
+        }
+    }
+}
+
 int main() {
     TestRunner tr;
     RUN_TEST(tr, TestLoadIni);
     RUN_TEST(tr, TestDocument);
     RUN_TEST(tr, TestUnknownSection);
     RUN_TEST(tr, TestDuplicateSections);
+    RUN_TEST(tr, TestLoadFile);
+    RUN_TEST(tr, TestLoadParallel);
+    RUN_TEST(tr, TestLineScanner);
+    RUN_TEST(tr, TestLoadFlat);
+    RUN_TEST(tr, TestReloadableDocument);
+    RUN_TEST(tr, TestReloadSmallFile);
+    RUN_TEST(tr, TestCompiled);
+    RUN_TEST(tr, TestParseVisitor);
+    RUN_TEST(tr, TestTypedSection);
+    RUN_TEST(tr, TestStringViewLookup);
+    RUN_TEST(tr, TestLoadWithSchema);
+    RUN_TEST(tr, TestOverlayDocument);
+    RUN_TEST(tr, TestSave);
     return 0;
 }
@@ -53,8 +53,8 @@ ostream& operator << (ostream& os, const map<K, V>& m) {
     return os << "}";
 }
 
-template <class K, class V>
-ostream& operator << (ostream& os, const unordered_map<K, V>& m) {
+template <class K, class V, class... Rest>
+ostream& operator << (ostream& os, const unordered_map<K, V, Rest...>& m) {
     os << "{";
     bool first = true;
     for (const auto& kv : m) {
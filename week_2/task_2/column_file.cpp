@@ -0,0 +1,217 @@
+#include "column_file.h"
+
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+    const char MAGIC[4] = {'S', 'C', 'O', 'L'};
+    const uint8_t VERSION = 1;
+    const size_t HEADER_SIZE = 16;
+    const size_t BLOCK_HEADER_SIZE = 8;
+
+    template<typename T>
+    T LoadLittleEndian(const char *p) {
+        T value;
+        memcpy(&value, p, sizeof(value));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        if constexpr (sizeof(T) == 4) {
+            value = __builtin_bswap32(value);
+        } else if constexpr (sizeof(T) == 8) {
+            value = __builtin_bswap64(value);
+        }
+#endif
+        return value;
+    }
+
+    template<typename T>
+    void StoreLittleEndian(string &out, T value) {
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            out.push_back(static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xFF));
+        }
+    }
+
+    uint64_t ZigZag(int64_t value) {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    int64_t UnZigZag(uint64_t value) {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    void PutVarint(string &out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    // Возвращает указатель на следующий байт или nullptr, если данные
+    // оборвались или число длиннее 10 байт
+    const char *GetVarint(const char *p, const char *end, uint64_t &value) {
+        value = 0;
+        for (int shift = 0; p != end && shift < 64; shift += 7) {
+            const auto byte = static_cast<uint8_t>(*p++);
+            value |= uint64_t(byte & 0x7F) << shift;
+            if (byte < 0x80) {
+                return p;
+            }
+        }
+        return nullptr;
+    }
+
+    int CheckedInt(int64_t value) {
+        if (value < INT_MIN || value > INT_MAX) {
+            throw invalid_argument("ColumnReader: value out of int range");
+        }
+        return static_cast<int>(value);
+    }
+}
+
+string EncodeColumn(const vector<int64_t> &values, size_t width, ColumnEncoding encoding, size_t block_size) {
+    if (width != 4 && width != 8) {
+        throw invalid_argument("EncodeColumn: width must be 4 or 8");
+    }
+    block_size = max<size_t>(block_size, 1);
+
+    string result(MAGIC, sizeof(MAGIC));
+    result.push_back(static_cast<char>(VERSION));
+    result.push_back(static_cast<char>(width));
+    result.push_back(static_cast<char>(encoding));
+    result.push_back(0);
+    StoreLittleEndian<uint64_t>(result, values.size());
+
+    string block;
+    for (size_t begin = 0; begin < values.size(); begin += block_size) {
+        const size_t end = min(values.size(), begin + block_size);
+        block.clear();
+        int64_t previous = 0;
+        for (size_t i = begin; i < end; ++i) {
+            switch (encoding) {
+                case ColumnEncoding::Plain:
+                    if (width == 4) {
+                        StoreLittleEndian<uint32_t>(block, static_cast<uint32_t>(values[i]));
+                    } else {
+                        StoreLittleEndian<uint64_t>(block, static_cast<uint64_t>(values[i]));
+                    }
+                    break;
+                case ColumnEncoding::Varint:
+                    PutVarint(block, ZigZag(values[i]));
+                    break;
+                case ColumnEncoding::Delta:
+                    PutVarint(block, ZigZag(static_cast<int64_t>(static_cast<uint64_t>(values[i]) - previous)));
+                    previous = values[i];
+                    break;
+            }
+        }
+        StoreLittleEndian<uint32_t>(result, static_cast<uint32_t>(end - begin));
+        StoreLittleEndian<uint32_t>(result, static_cast<uint32_t>(block.size()));
+        result += block;
+    }
+    return result;
+}
+
+ColumnReader::ColumnReader(string_view data) : data(data) {
+    if (data.size() < HEADER_SIZE || memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        throw invalid_argument("ColumnReader: not a column file");
+    }
+    if (static_cast<uint8_t>(data[4]) != VERSION) {
+        throw invalid_argument("ColumnReader: unsupported version");
+    }
+    width = static_cast<uint8_t>(data[5]);
+    if (width != 4 && width != 8) {
+        throw invalid_argument("ColumnReader: bad value width");
+    }
+    const auto raw_encoding = static_cast<uint8_t>(data[6]);
+    if (raw_encoding > static_cast<uint8_t>(ColumnEncoding::Delta)) {
+        throw invalid_argument("ColumnReader: unknown encoding");
+    }
+    encoding = static_cast<ColumnEncoding>(raw_encoding);
+    value_count = LoadLittleEndian<uint64_t>(data.data() + 8);
+    this->data.remove_prefix(HEADER_SIZE);
+}
+
+size_t ColumnReader::NextBlock(const int *&values) {
+    if (data.empty()) {
+        if (values_read != value_count) {
+            throw invalid_argument("ColumnReader: fewer values than in header");
+        }
+        return 0;
+    }
+    if (data.size() < BLOCK_HEADER_SIZE) {
+        throw invalid_argument("ColumnReader: truncated block header");
+    }
+    const size_t count = LoadLittleEndian<uint32_t>(data.data());
+    const size_t size = LoadLittleEndian<uint32_t>(data.data() + 4);
+    if (data.size() - BLOCK_HEADER_SIZE < size) {
+        throw invalid_argument("ColumnReader: truncated block");
+    }
+    // Пустой блок выглядел бы для вызывающего как конец данных
+    if (count == 0) {
+        throw invalid_argument("ColumnReader: empty block");
+    }
+    // Размер проверяется до выделения буфера: иначе заголовок блока
+    // мог бы запросить до 2^32 значений при нескольких байтах данных.
+    // Каждое значение varint занимает хотя бы байт.
+    if (encoding == ColumnEncoding::Plain ? size % width != 0 || size / width != count : count > size) {
+        throw invalid_argument("ColumnReader: block size does not match value count");
+    }
+    const char *p = data.data() + BLOCK_HEADER_SIZE;
+    const char *end = p + size;
+    data.remove_prefix(BLOCK_HEADER_SIZE + size);
+    values_read += count;
+    if (values_read > value_count) {
+        throw invalid_argument("ColumnReader: more values than in header");
+    }
+
+    if (encoding == ColumnEncoding::Plain) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        // Отображённый файл выровнен по странице, а заголовки кратны 4 байтам,
+        // так что блоки int32 обычно можно отдать как есть
+        if (width == 4 && reinterpret_cast<uintptr_t>(p) % alignof(int) == 0) {
+            values = reinterpret_cast<const int *>(p);
+            return count;
+        }
+#endif
+    }
+
+    buffer.resize(count);
+    switch (encoding) {
+        case ColumnEncoding::Plain:
+            for (size_t i = 0; i < count; ++i, p += width) {
+                buffer[i] = width == 4 ? static_cast<int>(LoadLittleEndian<uint32_t>(p))
+                                       : CheckedInt(static_cast<int64_t>(LoadLittleEndian<uint64_t>(p)));
+            }
+            break;
+        case ColumnEncoding::Varint:
+        case ColumnEncoding::Delta: {
+            const bool delta = encoding == ColumnEncoding::Delta;
+            uint64_t previous = 0;
+            for (size_t i = 0; i < count; ++i) {
+                uint64_t raw;
+                p = GetVarint(p, end, raw);
+                if (p == nullptr) {
+                    throw invalid_argument("ColumnReader: bad varint");
+                }
+                // Разности складываются по модулю 2^64, как и вычитались.
+                // Ширина 4 у varint ничего не ограничивает, поэтому значение
+                // вне int — это повреждённый блок при любой ширине
+                previous = delta ? previous + static_cast<uint64_t>(UnZigZag(raw)) : static_cast<uint64_t>(UnZigZag(raw));
+                buffer[i] = CheckedInt(static_cast<int64_t>(previous));
+            }
+            if (p != end) {
+                throw invalid_argument("ColumnReader: extra bytes in block");
+            }
+            break;
+        }
+    }
+    values = buffer.data();
+    return count;
+}
+
+uint64_t ColumnReader::ValueCount() const {
+    return value_count;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Бинарный колоночный формат для потока целых чисел. Все поля little-endian.
+//
+// Заголовок, 16 байт:
+//   char[4]  "SCOL"
+//   uint8    версия, 1
+//   uint8    ширина значения в байтах, 4 или 8
+//   uint8    кодирование, ColumnEncoding
+//   uint8    0
+//   uint64   общее число значений
+//
+// Затем блоки, каждый со своим заголовком из двух uint32: число значений
+// и размер данных блока в байтах. Блоки кодируются независимо друг от друга.
+//   Plain  — значения подряд, по ширине из заголовка;
+//   Varint — zigzag + LEB128 для каждого значения;
+//   Delta  — zigzag + LEB128 для разности с предыдущим значением блока
+//            (первое — разность с нулём); хорошо сжимает отсортированные
+//            и медленно меняющиеся ряды.
+enum class ColumnEncoding : uint8_t {
+    Plain = 0,
+    Varint = 1,
+    Delta = 2,
+};
+
+// Кодирует values в колоночный формат блоками по block_size значений.
+// Нужен производителям данных, тестам и замерам.
+std::string EncodeColumn(const std::vector<int64_t> &values, size_t width, ColumnEncoding encoding,
+                         size_t block_size = 1 << 16);
+
+// Читает колоночный формат из памяти, обычно из отображённого файла.
+// Нарушения формата и значения вне диапазона int приводят к invalid_argument.
+class ColumnReader {
+public:
+    explicit ColumnReader(std::string_view data);
+
+    // Декодирует следующий блок и возвращает число значений в нём; values
+    // указывает на них до следующего вызова. Блок Plain с int32 отдаётся
+    // прямо из data, без копирования. 0 означает конец данных.
+    size_t NextBlock(const int *&values);
+
+    uint64_t ValueCount() const;
+
+private:
+    std::string_view data;
+    size_t width = 0;
+    ColumnEncoding encoding = ColumnEncoding::Plain;
+    uint64_t value_count = 0;
+    uint64_t values_read = 0;
+    std::vector<int> buffer;
+};
+
+void TestColumnFile();
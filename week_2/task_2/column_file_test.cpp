@@ -0,0 +1,98 @@
+#include "column_file.h"
+#include "test_runner.h"
+
+#include <climits>
+
+using namespace std;
+
+namespace {
+    vector<int> DecodeAll(const string &data) {
+        ColumnReader reader(data);
+        vector<int> result;
+        const int *values = nullptr;
+        while (size_t count = reader.NextBlock(values)) {
+            result.insert(result.end(), values, values + count);
+        }
+        return result;
+    }
+
+    void AssertInvalid(const string &data, const string &hint) {
+        try {
+            DecodeAll(data);
+            Assert(false, "ColumnReader should throw std::invalid_argument: " + hint);
+        } catch (invalid_argument &) {
+        }
+    }
+
+    // Заголовок файла без блоков, с произвольным общим числом значений
+    string Header(ColumnEncoding encoding, uint64_t value_count) {
+        string result = EncodeColumn({}, 4, encoding);
+        for (size_t i = 0; i < 8; ++i) {
+            result[8 + i] = static_cast<char>(value_count >> (8 * i));
+        }
+        return result;
+    }
+
+    string BlockHeader(uint32_t count, uint32_t size) {
+        string result;
+        for (uint32_t field : {count, size}) {
+            for (size_t i = 0; i < 4; ++i) {
+                result.push_back(static_cast<char>(field >> (8 * i)));
+            }
+        }
+        return result;
+    }
+}
+
+void TestColumnFile() {
+    const vector<int64_t> values = {0, 1, -1, 1000, 999, INT_MAX, INT_MIN, 42, 42, 42, -7};
+    const vector<int> expected(values.begin(), values.end());
+
+    for (size_t width : {4u, 8u}) {
+        for (ColumnEncoding encoding : {ColumnEncoding::Plain, ColumnEncoding::Varint, ColumnEncoding::Delta}) {
+            for (size_t block_size : {1u, 3u, 100u}) {
+                const string data = EncodeColumn(values, width, encoding, block_size);
+                ASSERT_EQUAL(DecodeAll(data), expected);
+                ASSERT_EQUAL(ColumnReader(data).ValueCount(), values.size());
+            }
+            ASSERT_EQUAL(DecodeAll(EncodeColumn({}, width, encoding)), vector<int>());
+        }
+    }
+
+    // Блок Plain int32 читается прямо из данных файла
+    const string plain = EncodeColumn(values, 4, ColumnEncoding::Plain);
+    ColumnReader reader(plain);
+    const int *block = nullptr;
+    ASSERT_EQUAL(reader.NextBlock(block), values.size());
+    ASSERT(reinterpret_cast<const char *>(block) > plain.data());
+    ASSERT(reinterpret_cast<const char *>(block) < plain.data() + plain.size());
+
+    // Отсортированный ряд в Delta занимает по байту на значение
+    vector<int64_t> sorted(1000);
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        sorted[i] = 1'000'000 + int64_t(i) * 3;
+    }
+    ASSERT(EncodeColumn(sorted, 4, ColumnEncoding::Delta).size() < sorted.size() + 64);
+
+    const string good = EncodeColumn(values, 8, ColumnEncoding::Varint, 4);
+    AssertInvalid("", "empty");
+    AssertInvalid("XCOL" + good.substr(4), "magic");
+    AssertInvalid(good.substr(0, 5) + char(3) + good.substr(6), "width");
+    AssertInvalid(good.substr(0, 6) + char(9) + good.substr(7), "encoding");
+    AssertInvalid(good.substr(0, good.size() - 1), "truncated block");
+    AssertInvalid(good.substr(0, 16), "missing values");
+    AssertInvalid(EncodeColumn({int64_t(INT_MAX) + 1}, 8, ColumnEncoding::Plain), "int64 out of int range");
+    AssertInvalid(EncodeColumn({INT64_MIN}, 8, ColumnEncoding::Delta), "int64 out of int range");
+    // varint шириной 4 не обрезается до 32 бит
+    AssertInvalid(Header(ColumnEncoding::Varint, 1) + BlockHeader(1, 5) + "\x80\x80\x80\x80\x10",
+                  "varint out of int range");
+    AssertInvalid(EncodeColumn({1, int64_t(INT_MAX) + 1}, 4, ColumnEncoding::Delta), "delta out of int range");
+
+    // Число значений в блоке сверяется с его размером до выделения буфера
+    AssertInvalid(Header(ColumnEncoding::Varint, UINT64_MAX) + BlockHeader(UINT32_MAX, 1) + '\0', "varint count");
+    AssertInvalid(Header(ColumnEncoding::Plain, UINT64_MAX) + BlockHeader(UINT32_MAX, 4) + string(4, '\0'),
+                  "plain count");
+    AssertInvalid(Header(ColumnEncoding::Plain, 2) + BlockHeader(2, 9) + string(9, '\0'), "plain size");
+    AssertInvalid(Header(ColumnEncoding::Delta, 1) + BlockHeader(0, 0) + BlockHeader(1, 1) + '\0', "empty block");
+    ASSERT_EQUAL(DecodeAll(Header(ColumnEncoding::Delta, 1) + BlockHeader(1, 1) + char(6)), vector<int>({3}));
+}
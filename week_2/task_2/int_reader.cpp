@@ -0,0 +1,199 @@
+#include "int_reader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+using namespace std;
+
+namespace {
+    bool IsSpace(char c) {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    bool IsDigit(char c) {
+        return static_cast<unsigned char>(c - '0') < 10;
+    }
+
+    // Тип T вмещает не больше digits10 + 1 значащих десятичных цифр
+    template<typename T>
+    const char *ParseInteger(const char *begin, const char *end, T &result) {
+        if (begin == end) {
+            return nullptr;
+        }
+        const bool negative = *begin == '-';
+        const char *digits = begin + (negative || *begin == '+');
+        // Ведущие нули не значащие и в лимит цифр не входят, как и у operator>>
+        const char *p = digits;
+        while (p != end && *p == '0') {
+            ++p;
+        }
+        const char *limit = p + min<size_t>(end - p, numeric_limits<T>::digits10 + 1);
+        uint64_t value = 0;
+        while (p != limit && IsDigit(*p)) {
+            value = value * 10 + (*p - '0');
+            ++p;
+        }
+        // Модуль минимального значения на единицу больше максимального
+        if (p == digits || (p != end && IsDigit(*p))
+            || value > static_cast<uint64_t>(numeric_limits<T>::max()) + negative) {
+            return nullptr;
+        }
+
+        using Unsigned = make_unsigned_t<T>;
+        const auto magnitude = static_cast<Unsigned>(value);
+        result = static_cast<T>(negative ? Unsigned(0) - magnitude : magnitude);
+        return p;
+    }
+
+    const char *SkipSpaces(const char *p, const char *end) {
+        while (p != end && IsSpace(*p)) {
+            ++p;
+        }
+        return p;
+    }
+}
+
+const char *ParseInt(const char *begin, const char *end, int &result) {
+    return ParseInteger(begin, end, result);
+}
+
+const char *ParseInt64(const char *begin, const char *end, int64_t &result) {
+    return ParseInteger(begin, end, result);
+}
+
+IntReader::IntReader(FILE *input, size_t block_size)
+        : input(input), block_size(block_size) {
+}
+
+IntReader::IntReader(string_view data) : window(data), eof(true) {
+}
+
+bool IntReader::Refill() {
+    if (eof) {
+        return false;
+    }
+
+    // Незаконченный токен из конца прошлого блока переносится в начало
+    const size_t carried = carry.size();
+    const size_t carry_begin = carried > 0 ? carry.data() - buffer.data() : 0;
+    buffer.resize(max(buffer.size(), carried + block_size));
+    memmove(buffer.data(), buffer.data() + carry_begin, carried);
+
+    const size_t read = fread(buffer.data() + carried, 1, block_size, input);
+    if (read < block_size) {
+        eof = true;
+    }
+    const size_t size = carried + read;
+
+    // Разбираем только до последнего пробельного символа: токен в конце
+    // блока может продолжиться в следующем
+    size_t complete = size;
+    if (!eof) {
+        while (complete > 0 && !IsSpace(buffer[complete - 1])) {
+            --complete;
+        }
+    }
+    window = string_view(buffer.data(), complete);
+    carry = string_view(buffer.data() + complete, size - complete);
+    return size > 0;
+}
+
+size_t IntReader::ReadBatch(int *values, size_t capacity) {
+    size_t count = 0;
+    while (count < capacity && !failed) {
+        const char *p = window.data();
+        const char *end = p + window.size();
+
+        while (count < capacity) {
+            p = SkipSpaces(p, end);
+            if (p == end) {
+                break;
+            }
+
+            const char *q = ParseInt(p, end, values[count]);
+            if (q == nullptr) {
+                failed = true;
+                break;
+            }
+            ++count;
+            p = q;
+        }
+
+        window_offset += p - window.data();
+        window.remove_prefix(p - window.data());
+
+        if (failed || count == capacity) {
+            break;
+        }
+        if (!Refill()) {
+            break;
+        }
+    }
+    return count;
+}
+
+size_t IntReader::ReadPairs(int64_t *timestamps, int *values, size_t capacity) {
+    size_t count = 0;
+    while (count < capacity && !failed) {
+        const char *p = window.data();
+        const char *end = p + window.size();
+        bool split_pair = false;
+
+        while (count < capacity) {
+            p = SkipSpaces(p, end);
+            if (p == end) {
+                break;
+            }
+
+            const char *q = ParseInt64(p, end, timestamps[count]);
+            if (q == nullptr) {
+                failed = true;
+                break;
+            }
+            q = SkipSpaces(q, end);
+            if (q == end) {
+                // Значение пары осталось в следующем блоке
+                split_pair = true;
+                break;
+            }
+            q = ParseInt(q, end, values[count]);
+            if (q == nullptr) {
+                failed = true;
+                break;
+            }
+            ++count;
+            p = q;
+        }
+
+        window_offset += p - window.data();
+        window.remove_prefix(p - window.data());
+
+        if (failed || count == capacity) {
+            break;
+        }
+        if (split_pair) {
+            if (eof) {
+                // Непарное последнее число отбрасывается
+                break;
+            }
+            // Начатая пара переносится в следующий блок вместе с хвостом
+            const char *tail_end = carry.empty() ? end : carry.data() + carry.size();
+            carry = string_view(p, tail_end - p);
+            window = {};
+        }
+        if (!Refill()) {
+            break;
+        }
+    }
+    return count;
+}
+
+bool IntReader::Failed() const {
+    return failed;
+}
+
+uint64_t IntReader::Offset() const {
+    return window_offset;
+}
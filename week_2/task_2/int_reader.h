@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Читает целые числа, разделённые пробельными символами, крупными блоками
+// и разбирает их вручную, без локалей и синхронизации iostream.
+// Правила те же, что у цикла `cin >> value`: чтение останавливается
+// на первом токене, который не начинается с числа или не помещается в int.
+class IntReader {
+public:
+    static const size_t DEFAULT_BLOCK_SIZE = 1 << 20;
+
+    // Читает из потока stdio блоками по block_size байт. Данные, уже
+    // попавшие в буфер FILE (например, после чтения заголовка через cin),
+    // не теряются.
+    explicit IntReader(FILE *input, size_t block_size = DEFAULT_BLOCK_SIZE);
+
+    // Разбирает данные, уже находящиеся в памяти (например, отображённый файл)
+    explicit IntReader(std::string_view data);
+
+    // Записывает в values до capacity чисел и возвращает их количество;
+    // 0 означает конец ввода или ошибку разбора
+    size_t ReadBatch(int *values, size_t capacity);
+
+    // Читает до capacity пар «метка времени, значение»: метка разбирается
+    // как int64_t (миллисекунды эпохи не помещаются в int), значение как int.
+    // Непарное последнее число отбрасывается
+    size_t ReadPairs(int64_t *timestamps, int *values, size_t capacity);
+
+    // true, если чтение остановилось на некорректном токене, а не на конце ввода
+    bool Failed() const;
+
+    // Сколько байт ввода уже разобрано
+    uint64_t Offset() const;
+
+private:
+    // Подчитывает следующий блок; в буфере остаются только полные токены
+    bool Refill();
+
+    FILE *input = nullptr;
+    size_t block_size = 0;
+    std::vector<char> buffer;
+    std::string_view carry;
+
+    std::string_view window;
+    uint64_t window_offset = 0;
+    bool eof = false;
+    bool failed = false;
+};
+
+// Разбирает целое число в начале [begin, end) по тем же правилам, что IntReader.
+// Возвращает указатель на символ после числа или nullptr, если числа там нет
+// или оно не помещается в int.
+const char *ParseInt(const char *begin, const char *end, int &result);
+
+// То же для int64_t
+const char *ParseInt64(const char *begin, const char *end, int64_t &result);
+
+void TestIntReader();
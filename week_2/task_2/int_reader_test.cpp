@@ -0,0 +1,125 @@
+#include "int_reader.h"
+#include "test_runner.h"
+
+#include <cstdio>
+#include <sstream>
+
+using namespace std;
+
+namespace {
+    vector<int> ReadAll(IntReader &reader, size_t batch_size) {
+        vector<int> result;
+        vector<int> batch(batch_size);
+        while (size_t count = reader.ReadBatch(batch.data(), batch.size())) {
+            result.insert(result.end(), batch.begin(), batch.begin() + count);
+        }
+        return result;
+    }
+
+    vector<int> ReadWithStream(const string &text) {
+        istringstream input(text);
+        vector<int> result;
+        for (int value; input >> value; ) {
+            result.push_back(value);
+        }
+        return result;
+    }
+
+    // Пары разворачиваются в плоский список «метка, значение, ...»
+    using Pairs = vector<int64_t>;
+
+    Pairs ReadAllPairs(IntReader &reader, size_t batch_size) {
+        Pairs result;
+        vector<int64_t> timestamps(batch_size);
+        vector<int> values(batch_size);
+        while (size_t count = reader.ReadPairs(timestamps.data(), values.data(), batch_size)) {
+            for (size_t i = 0; i < count; ++i) {
+                result.push_back(timestamps[i]);
+                result.push_back(values[i]);
+            }
+        }
+        return result;
+    }
+
+    Pairs ReadPairsWithStream(const string &text) {
+        istringstream input(text);
+        Pairs result;
+        int64_t timestamp;
+        for (int value; input >> timestamp >> value; ) {
+            result.push_back(timestamp);
+            result.push_back(value);
+        }
+        return result;
+    }
+}
+
+void TestIntReader() {
+    const vector<string> inputs = {
+            "",
+            "   \n",
+            "1 2 3",
+            "3 8 -1 16 16\n",
+            "+7\t-0 \r\n 0012 ",
+            "2147483647 -2147483648 5",
+            "1 2147483648 3",
+            "4 -2147483649 3",
+            "5 12abc 7",
+            "6 - 7",
+            "123456789012345678901234567890 1",
+            "  -42",
+            "00000000001 2",
+            "-00000000000005 3",
+            "000000000000000000002147483647 0000 -0002147483648",
+            "00000000002147483648 1",
+    };
+
+    for (const string &text : inputs) {
+        const vector<int> expected = ReadWithStream(text);
+
+        IntReader in_memory(text);
+        ASSERT_EQUAL(ReadAll(in_memory, 2), expected);
+
+        for (size_t block_size : {1u, 2u, 3u, 7u, 64u}) {
+            string copy = text;
+            FILE *file = fmemopen(copy.data(), copy.size() + (copy.empty() ? 1 : 0), "r");
+            IntReader from_file(file, block_size);
+            ASSERT_EQUAL(ReadAll(from_file, 3), expected);
+            fclose(file);
+        }
+    }
+
+    IntReader failed("1 2 x 3");
+    ASSERT_EQUAL(ReadAll(failed, 10), vector<int>({1, 2}));
+    ASSERT(failed.Failed());
+    ASSERT_EQUAL(failed.Offset(), 4u);
+
+    IntReader finished("1 2 ");
+    ASSERT_EQUAL(ReadAll(finished, 10), vector<int>({1, 2}));
+    ASSERT(!finished.Failed());
+
+    const vector<string> pair_inputs = {
+            "",
+            "1 2 3 4",
+            "1 2 3",
+            "1700000000000 5\n1700000000001 -3\n",
+            "9223372036854775807 1 -9223372036854775808 2",
+            "9223372036854775808 1",
+            "1 2147483648 3 4",
+            "1 2 x 3",
+            "  000000000000000000001700000000000    7  ",
+    };
+    for (const string &text : pair_inputs) {
+        const Pairs expected = ReadPairsWithStream(text);
+
+        IntReader in_memory(text);
+        ASSERT_EQUAL(ReadAllPairs(in_memory, 2), expected);
+
+        for (size_t block_size : {1u, 2u, 3u, 7u, 64u}) {
+            string copy = text;
+            FILE *file = fmemopen(copy.data(), copy.size() + (copy.empty() ? 1 : 0), "r");
+            IntReader from_file(file, block_size);
+            ASSERT_EQUAL(ReadAllPairs(from_file, 1), expected);
+            fclose(file);
+        }
+    }
+}
@@ -1,54 +1,626 @@
 #include "test_runner.h"
 #include "stats_aggregator.h"
+#include "stats_window.h"
+#include "stats_group.h"
+#include "stats_checkpoint.h"
+#include "stats_pipeline.h"
+#include "int_reader.h"
+#include "column_file.h"
+#include "mapped_file.h"
 
 #include <vector>
 #include <string>
 #include <map>
 #include <memory>
 #include <iostream>
+#include <fstream>
+#include <optional>
 #include <unordered_map>
+#include <limits>
 #include <functional>
+#include <cctype>
+#include <future>
+#include <thread>
+#include <random>
+#include <sstream>
 using namespace std;
 using namespace StatsAggregators;
 
 void TestAll();
 
-unique_ptr<StatsAggregator> ReadAggregators(istream& input) {
-    const unordered_map<string, std::function<unique_ptr<StatsAggregator>()>> known_builders = {
-            {"sum", [] { return make_unique<Sum>(); }},
-            {"min", [] { return make_unique<Min>(); }},
-            {"max", [] { return make_unique<Max>(); }},
-            {"avg", [] { return make_unique<Average>(); }},
-            {"mode", [] { return make_unique<Mode>(); }}
+// Как построить агрегатор отдельно и как колонку для GROUP BY
+struct AggregatorKind {
+    std::function<unique_ptr<StatsAggregator>()> single;
+    std::function<unique_ptr<GroupColumn>()> column;
+    // Результат скетча зависит от того, как вход разбит на части для Merge
+    bool order_sensitive = false;
+};
+
+template<typename Aggregator, typename... Args>
+AggregatorKind Kind(Args... args) {
+    return {
+            [=] { return make_unique<Aggregator>(args...); },
+            [=] { return make_unique<TypedGroupColumn<Aggregator>>(Aggregator(args...)); }
     };
+}
 
-    auto result = make_unique<Composite>();
+AggregatorKind OrderSensitive(AggregatorKind kind) {
+    kind.order_sensitive = true;
+    return kind;
+}
+
+// Неизвестное имя приводит к out_of_range
+AggregatorKind FindAggregatorKind(const string &name) {
+    static const unordered_map<string, AggregatorKind> known_kinds = {
+            {"sum", Kind<Sum>()},
+            {"min", Kind<Min>()},
+            {"max", Kind<Max>()},
+            {"avg", Kind<Average>()},
+            {"mode", Kind<Mode>()},
+            {"mode~", OrderSensitive(Kind<ApproximateMode>())},
+            {"distinct", Kind<Distinct>()},
+            {"p50", OrderSensitive(Kind<Quantile>(0.5))},
+            {"p90", OrderSensitive(Kind<Quantile>(0.9))},
+            {"p95", OrderSensitive(Kind<Quantile>(0.95))},
+            {"p99", OrderSensitive(Kind<Quantile>(0.99))}
+    };
+    // Оконные варианты записываются как "sum@100" (последние 100 значений)
+    // или "sum@10s" (последние 10 секунд, нужен --timestamped)
+    static const unordered_map<string, std::function<AggregatorKind(WindowSpan)>> windowed_kinds = {
+            {"sum", [](WindowSpan span) { return Kind<WindowedSum>(span); }},
+            {"min", [](WindowSpan span) { return Kind<WindowedMin>(span); }},
+            {"max", [](WindowSpan span) { return Kind<WindowedMax>(span); }},
+            {"avg", [](WindowSpan span) { return Kind<WindowedAverage>(span); }},
+            {"mode", [](WindowSpan span) { return Kind<WindowedMode>(span); }}
+    };
+
+    const size_t at = name.find('@');
+    if (at == string::npos) {
+        return known_kinds.at(name);
+    }
+    return windowed_kinds.at(name.substr(0, at))(WindowSpan::Parse(name.substr(at + 1)));
+}
+
+// Стадия конвейера из аргумента командной строки: "--filter" с выражением
+// вроде ">0" или "!=5", "--map" с "*3", "+10", "-1" или "/2", "--sample" с долей.
+// Арифметика — по модулю 2^32, как у Sum. Ошибки записи приводят к invalid_argument.
+Stage ParseStage(const string &flag, const string &expression) {
+    if (flag == "--sample") {
+        return Sample(stod(expression));
+    }
+
+    const size_t operator_size = expression.size() > 1 && expression[1] == '=' ? 2 : 1;
+    const string op = expression.substr(0, operator_size);
+    size_t parsed = 0;
+    const long long operand_value = expression.size() > operator_size ? stoll(expression.substr(operator_size), &parsed) : 0;
+    if (parsed == 0 || operator_size + parsed != expression.size()
+        || operand_value < numeric_limits<int>::min() || operand_value > numeric_limits<int>::max()) {
+        throw invalid_argument("bad " + flag + " expression " + expression);
+    }
+    const int operand = static_cast<int>(operand_value);
 
-    int aggr_count;
+    if (flag == "--filter") {
+        static const unordered_map<string, std::function<bool(int, int)>> comparisons = {
+                {">", greater<int>()}, {">=", greater_equal<int>()}, {"<", less<int>()},
+                {"<=", less_equal<int>()}, {"==", equal_to<int>()}, {"!=", not_equal_to<int>()}
+        };
+        auto it = comparisons.find(op);
+        if (it != comparisons.end()) {
+            return Filter([compare = it->second, operand](int value) { return compare(value, operand); });
+        }
+    } else if (flag == "--map" && operator_size == 1) {
+        const auto wrapped = static_cast<uint32_t>(operand);
+        switch (op[0]) {
+            case '+':
+                return Map([wrapped](int value) { return static_cast<int>(static_cast<uint32_t>(value) + wrapped); });
+            case '-':
+                return Map([wrapped](int value) { return static_cast<int>(static_cast<uint32_t>(value) - wrapped); });
+            case '*':
+                return Map([wrapped](int value) { return static_cast<int>(static_cast<uint32_t>(value) * wrapped); });
+            case '/':
+                if (operand != 0) {
+                    // INT_MIN / -1 не помещается в int и тоже заворачивается
+                    return Map([operand](int value) { return static_cast<int>(int64_t(value) / operand); });
+                }
+                break;
+        }
+    }
+    throw invalid_argument("bad " + flag + " expression " + expression);
+}
+
+vector<pair<string, AggregatorKind>> ReadAggregatorKinds(istream& input) {
+    int aggr_count = 0;
     input >> aggr_count;
 
-    string line;
-    for (int i = 0; i < aggr_count; ++i) {
-        input >> line;
-        result->Add(known_builders.at(line)());
+    vector<pair<string, AggregatorKind>> kinds(aggr_count);
+    for (auto &[name, kind] : kinds) {
+        input >> name;
+        kind = FindAggregatorKind(name);
+    }
+    return kinds;
+}
+
+// Имена через пробел: так контрольная точка помнит, для каких агрегаторов снята
+string AggregatorSpec(const vector<pair<string, AggregatorKind>> &kinds) {
+    string result;
+    for (const auto &[name, kind] : kinds) {
+        result += (result.empty() ? "" : " ") + name;
+    }
+    return result;
+}
+
+unique_ptr<StatsAggregator> MakeAggregators(const vector<pair<string, AggregatorKind>> &kinds) {
+    vector<string> names;
+    for (const auto &[name, kind] : kinds) {
+        names.push_back(name);
+    }
+    if (auto result = MakeStaticComposite(names)) {
+        return result;
+    }
+
+    auto result = make_unique<Composite>();
+    for (const auto &[name, kind] : kinds) {
+        result->Add(kind.single());
     }
+    return result;
+}
 
+GroupedStats MakeGroupedAggregators(const vector<pair<string, AggregatorKind>> &kinds) {
+    GroupedStats result;
+    for (const auto &[name, kind] : kinds) {
+        result.AddColumn(kind.column());
+    }
     return result;
 }
 
-int main() {
+const size_t BATCH_SIZE = 4096;
+
+// Вызывается после каждого блока с числом значений в нём; нужен для контрольных точек
+using AfterBatch = function<void(size_t count)>;
+
+void ProcessSequential(StatsAggregator &stats_aggregator, IntReader &reader, const AfterBatch &after_batch = {}) {
+    vector<int> batch(BATCH_SIZE);
+    while (size_t count = reader.ReadBatch(batch.data(), batch.size())) {
+        stats_aggregator.ProcessBatch(batch.data(), count);
+        if (after_batch) {
+            after_batch(count);
+        }
+    }
+}
+
+// Вход — пары "метка_времени значение"; метки в секундах, 64-битные
+void ProcessTimestamped(StatsAggregator &stats_aggregator, IntReader &reader, const AfterBatch &after_batch = {}) {
+    vector<int64_t> timestamps(BATCH_SIZE / 2);
+    vector<int> values(BATCH_SIZE / 2);
+    while (size_t count = reader.ReadPairs(timestamps.data(), values.data(), values.size())) {
+        for (size_t i = 0; i < count; ++i) {
+            stats_aggregator.ProcessAt(timestamps[i], values[i]);
+        }
+        if (after_batch) {
+            after_batch(2 * count);
+        }
+    }
+}
+
+// Текст делится на куски по пробельным символам, и каждый поток сам
+// разбирает свой кусок своим IntReader в собственную копию агрегатора;
+// копии сливаются по порядку кусков. Памяти сверх входа нужно по блоку
+// на поток. Результат совпадает с последовательным проходом, только если
+// этого не ломает ни один агрегатор и ни одна стадия, см. CanProcessInParallel.
+// Возвращает число разобранных байт text: меньше text.size() — вход оборван
+// не-числом, и значения после обрыва, как и при последовательном проходе,
+// не учитываются.
+size_t ProcessParallel(StatsAggregator &stats_aggregator, string_view text, size_t thread_count) {
+    vector<size_t> bounds = {0};
+    for (size_t i = 1; i < thread_count; ++i) {
+        size_t bound = max(bounds.back(), text.size() / thread_count * i);
+        while (bound < text.size() && !isspace(static_cast<unsigned char>(text[bound]))) {
+            ++bound;
+        }
+        bounds.push_back(bound);
+    }
+    bounds.push_back(text.size());
+
+    struct Partial {
+        unique_ptr<StatsAggregator> aggregator;
+        bool failed = false;
+        size_t parsed = 0;
+    };
+    vector<future<Partial>> partials;
+    for (size_t i = 0; i + 1 < bounds.size(); ++i) {
+        const string_view chunk = text.substr(bounds[i], bounds[i + 1] - bounds[i]);
+        partials.push_back(async(launch::async, [chunk, &stats_aggregator] {
+            Partial partial{stats_aggregator.Clone()};
+            IntReader reader(chunk);
+            vector<int> batch(BATCH_SIZE);
+            while (size_t count = reader.ReadBatch(batch.data(), batch.size())) {
+                partial.aggregator->ProcessBatch(batch.data(), count);
+            }
+            partial.failed = reader.Failed();
+            partial.parsed = reader.Offset();
+            return partial;
+        }));
+    }
+
+    // Клоны сняты с ещё пустого агрегатора, так что слияние ничего не удваивает
+    auto prototype = stats_aggregator.Clone();
+    size_t parsed = 0;
+    bool failed = false;
+    for (size_t i = 0; i < partials.size(); ++i) {
+        Partial partial = partials[i].get();
+        if (failed) {
+            continue;
+        }
+        prototype->Merge(*partial.aggregator);
+        parsed = bounds[i] + partial.parsed;
+        failed = partial.failed;
+    }
+    stats_aggregator.Merge(*prototype);
+    return parsed;
+}
+
+// Скетчи mode~ и p* после Merge дают оценку, зависящую от границ кусков,
+// а копии Sample в потоках повторяют одну и ту же выборку. С ними
+// --threads не действует, и вывод не отличается от последовательного.
+bool CanProcessInParallel(const vector<pair<string, AggregatorKind>> &kinds,
+                          const vector<pair<string, string>> &stage_args) {
+    for (const auto &[name, kind] : kinds) {
+        if (kind.order_sensitive) {
+            return false;
+        }
+    }
+    for (const auto &[flag, expression] : stage_args) {
+        if (flag == "--sample") {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Блоки колоночного файла идут в агрегатор как есть, без разбора текста
+void ProcessColumnar(StatsAggregator &stats_aggregator, ColumnReader &reader) {
+    const int *values = nullptr;
+    while (size_t count = reader.NextBlock(values)) {
+        stats_aggregator.ProcessBatch(values, count);
+    }
+}
+
+// Пропускает size байт: перемоткой, если поток её допускает, иначе чтением
+void SkipInput(FILE *input, uint64_t size) {
+    if (fseek(input, static_cast<long>(size), SEEK_CUR) == 0) {
+        return;
+    }
+    char block[1 << 16];
+    while (size > 0) {
+        const size_t read = fread(block, 1, min<uint64_t>(size, sizeof(block)), input);
+        if (read == 0) {
+            return;
+        }
+        size -= read;
+    }
+}
+
+string ReadRest(FILE *input) {
+    string result;
+    char block[1 << 16];
+    while (size_t read = fread(block, 1, sizeof(block), input)) {
+        result.append(block, read);
+    }
+    return result;
+}
+
+// Необязательные аргументы:
+//   --threads N    включает параллельную обработку, если её результат не
+//                  отличается от последовательного (см. CanProcessInParallel)
+//   --input PATH   читает данные из файла через mmap вместо stdin
+//   --timestamped  данные — пары "метка_времени значение" для окон по времени
+//   --group-by     данные — пары "ключ значение", результат печатается по ключам;
+//                  несовместим со стадиями --filter, --map и --sample,
+//                  а также с --timestamped, --threads и --checkpoint
+//   --columnar PATH данные — колоночный файл (см. column_file.h), а список
+//                  агрегаторов по-прежнему читается из stdin; несовместим
+//                  с --group-by, --timestamped, --threads и --checkpoint
+//   --checkpoint PATH  периодически сохраняет состояние в PATH (см. stats_checkpoint.h);
+//                  если PATH уже есть, восстанавливает состояние из него и
+//                  продолжает с сохранённой позиции входа, пропуская разобранное.
+//                  Работает с последовательной обработкой текстового входа,
+//                  --threads при этом не действует; несовместим с --sample
+//   --checkpoint-every N  как часто снимать точку, в значениях; по умолчанию 2^24
+//   --filter EXPR, --map EXPR, --sample RATE  стадии перед агрегаторами
+//                  (см. ParseStage), применяются в порядке аргументов
+struct Options {
+    size_t thread_count = 1;
+    string input_path;
+    string columnar_path;
+    string checkpoint_path;
+    uint64_t checkpoint_every = 1 << 24;
+    vector<pair<string, string>> stage_args;
+    bool timestamped = false;
+    bool group_by = false;
+};
+
+// Несовместимые сочетания флагов приводят к invalid_argument,
+// а не молча теряют часть настроек
+Options ParseOptions(int argc, const char *const *argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (string(argv[i]) == "--timestamped") {
+            options.timestamped = true;
+        } else if (string(argv[i]) == "--group-by") {
+            options.group_by = true;
+        } else if (i + 1 == argc) {
+            break;
+        } else if (string(argv[i]) == "--threads") {
+            options.thread_count = max(stoul(argv[i + 1]), 1ul);
+        } else if (string(argv[i]) == "--input") {
+            options.input_path = argv[i + 1];
+        } else if (string(argv[i]) == "--columnar") {
+            options.columnar_path = argv[i + 1];
+        } else if (string(argv[i]) == "--checkpoint") {
+            options.checkpoint_path = argv[i + 1];
+        } else if (string(argv[i]) == "--checkpoint-every") {
+            options.checkpoint_every = max(stoull(argv[i + 1]), 1ull);
+        } else if (string(argv[i]) == "--filter" || string(argv[i]) == "--map" || string(argv[i]) == "--sample") {
+            options.stage_args.emplace_back(argv[i], argv[i + 1]);
+        }
+    }
+
+    // В колоночном файле нет ключей и меток времени, а параллельного
+    // разбора и контрольных точек для него нет
+    if (!options.columnar_path.empty()
+        && (options.group_by || options.timestamped || options.thread_count > 1 || !options.checkpoint_path.empty())) {
+        throw invalid_argument("--columnar cannot be combined with --group-by, --timestamped, --threads or --checkpoint");
+    }
+    // GroupedStats разбирает строки сам, и стадиям негде встать перед колонками
+    if (options.group_by && !options.stage_args.empty()) {
+        throw invalid_argument("--group-by cannot be combined with --filter, --map or --sample");
+    }
+    // Состояние генератора Sample в точку не попадает, и продолженный
+    // прогон выбрал бы другие значения
+    if (!options.checkpoint_path.empty()) {
+        for (const auto &[flag, expression] : options.stage_args) {
+            if (flag == "--sample") {
+                throw invalid_argument("--checkpoint cannot be combined with --sample");
+            }
+        }
+    }
+    // Пары "ключ значение" обрабатываются одним проходом, без меток
+    // времени, потоков и контрольных точек
+    if (options.group_by && (options.timestamped || options.thread_count > 1 || !options.checkpoint_path.empty())) {
+        throw invalid_argument("--group-by cannot be combined with --timestamped, --threads or --checkpoint");
+    }
+    return options;
+}
+
+int main(int argc, char **argv) {
     TestAll();
 
-    auto stats_aggregator = ReadAggregators(cin);
+    const Options options = ParseOptions(argc, argv);
 
-    for (int value; cin >> value; ) {
-        stats_aggregator->Process(value);
+    // cin синхронизирован с stdio, поэтому после чтения заголовка
+    // остаток ввода целиком лежит в stdin
+    ifstream header_file;
+    if (!options.input_path.empty()) {
+        header_file.open(options.input_path);
+    }
+    istream &header = options.input_path.empty() ? cin : header_file;
+
+    const auto kinds = ReadAggregatorKinds(header);
+    unique_ptr<StatsAggregator> stats_aggregator;
+    optional<GroupedStats> grouped;
+    if (options.group_by) {
+        grouped = MakeGroupedAggregators(kinds);
+    } else {
+        stats_aggregator = MakeAggregators(kinds);
+    }
+    if (!options.stage_args.empty()) {
+        auto pipeline = make_unique<Pipeline>(move(stats_aggregator));
+        for (const auto &[flag, expression] : options.stage_args) {
+            pipeline->AddStage(ParseStage(flag, expression));
+        }
+        stats_aggregator = move(pipeline);
+    }
+
+    if (!options.columnar_path.empty()) {
+        MappedFile columnar(options.columnar_path);
+        ColumnReader reader(columnar.Data());
+        ProcessColumnar(*stats_aggregator, reader);
+        stats_aggregator->PrintValue(cout);
+        return 0;
+    }
+
+    optional<MappedFile> mapped;
+    string_view data;
+    string stdin_text;
+    if (!options.input_path.empty()) {
+        const streamoff header_size = header_file.tellg();
+        mapped.emplace(options.input_path);
+        data = mapped->Data();
+        data.remove_prefix(header_size < 0 ? data.size() : min<size_t>(header_size, data.size()));
+    } else if (options.group_by) {
+        stdin_text = ReadRest(stdin);
+        data = stdin_text;
+    }
+
+    // Вход, оборванный не-числом, обрабатывается до этого места, как с cin,
+    // но об обрыве сообщается в stderr и кодом возврата
+    if (options.group_by) {
+        const bool complete = grouped->ProcessText(data);
+        grouped->PrintValue(cout);
+        if (!complete) {
+            cerr << "Input stopped at a value that is not an int" << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // Параллельному разбору нужен весь текст в памяти: stdin читается целиком
+    if (options.checkpoint_path.empty() && !options.timestamped && options.thread_count > 1
+        && CanProcessInParallel(kinds, options.stage_args)) {
+        if (options.input_path.empty()) {
+            stdin_text = ReadRest(stdin);
+            data = stdin_text;
+        }
+        const size_t parsed = ProcessParallel(*stats_aggregator, data, options.thread_count);
+        stats_aggregator->PrintValue(cout);
+        if (parsed < data.size()) {
+            cerr << "Input stopped at byte " << parsed << " of the values: not an int" << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    optional<Checkpointer> checkpointer;
+    uint64_t resume_offset = 0;
+    if (!options.checkpoint_path.empty()) {
+        // Точка, снятая с другими стадиями, относится к другому потоку значений
+        string spec = AggregatorSpec(kinds);
+        for (const auto &[flag, expression] : options.stage_args) {
+            spec += " " + flag + " " + expression;
+        }
+        if (auto checkpoint = ReadCheckpoint(options.checkpoint_path)) {
+            if (checkpoint->spec != spec) {
+                throw invalid_argument("checkpoint " + options.checkpoint_path + " was taken for \"" + checkpoint->spec + "\"");
+            }
+            string_view state = checkpoint->state;
+            stats_aggregator->LoadState(state);
+            resume_offset = checkpoint->offset;
+        }
+        checkpointer.emplace(options.checkpoint_path, spec);
+
+        if (options.input_path.empty()) {
+            SkipInput(stdin, resume_offset);
+        } else {
+            data.remove_prefix(min<uint64_t>(resume_offset, data.size()));
+        }
+    }
+
+    IntReader reader = options.input_path.empty() ? IntReader(stdin) : IntReader(data);
+    if (checkpointer) {
+        // Если прошлая точка ещё пишется, новая снимается после следующего блока
+        uint64_t since_checkpoint = 0;
+        auto after_batch = [&](size_t count) {
+            since_checkpoint += count;
+            if (since_checkpoint >= options.checkpoint_every
+                && checkpointer->Save(*stats_aggregator, resume_offset + reader.Offset())) {
+                since_checkpoint = 0;
+            }
+        };
+        if (options.timestamped) {
+            ProcessTimestamped(*stats_aggregator, reader, after_batch);
+        } else {
+            ProcessSequential(*stats_aggregator, reader, after_batch);
+        }
+        checkpointer->Wait();
+        checkpointer->Save(*stats_aggregator, resume_offset + reader.Offset());
+        checkpointer->Wait();
+    } else if (options.timestamped) {
+        ProcessTimestamped(*stats_aggregator, reader);
+    } else {
+        ProcessSequential(*stats_aggregator, reader);
     }
     stats_aggregator->PrintValue(cout);
 
+    if (reader.Failed()) {
+        cerr << "Input stopped at byte " << resume_offset + reader.Offset() << " of the values: not an int" << endl;
+        return 1;
+    }
     return 0;
 }
 
+void TestProcessParallel() {
+    mt19937 random(17);
+    uniform_int_distribution<int> distribution(-1000, 1000);
+    string text;
+    for (size_t i = 0; i < 5 * BATCH_SIZE + 7; ++i) {
+        text += to_string(distribution(random)) + ' ';
+    }
+
+    auto kinds_of = [](const vector<string> &names) {
+        vector<pair<string, AggregatorKind>> kinds;
+        for (const string &name : names) {
+            kinds.emplace_back(name, FindAggregatorKind(name));
+        }
+        return kinds;
+    };
+    auto printed = [](const StatsAggregator &aggr) {
+        ostringstream output;
+        aggr.PrintValue(output);
+        return output.str();
+    };
+
+    for (const vector<string> &names : vector<vector<string>>{
+            {"sum", "min", "max", "avg", "mode"}, {"distinct", "mode"}, {"sum@100", "mode@50", "avg"}}) {
+        const auto kinds = kinds_of(names);
+        ASSERT(CanProcessInParallel(kinds, {}));
+
+        auto sequential = MakeAggregators(kinds);
+        IntReader sequential_reader(text);
+        ProcessSequential(*sequential, sequential_reader);
+        for (size_t thread_count : {2u, 3u, 8u}) {
+            auto parallel = MakeAggregators(kinds);
+            ASSERT_EQUAL(ProcessParallel(*parallel, text, thread_count), text.size());
+            ASSERT_EQUAL(printed(*parallel), printed(*sequential));
+        }
+    }
+
+    // Обрыв в середине: значения после него не учитываются ни в одном потоке
+    string broken = text;
+    broken.replace(broken.find(' ', broken.size() / 3) + 1, 1, "x");
+    const auto kinds = kinds_of({"sum", "min", "max", "mode"});
+    auto sequential = MakeAggregators(kinds);
+    IntReader sequential_reader(broken);
+    ProcessSequential(*sequential, sequential_reader);
+    ASSERT(sequential_reader.Failed());
+    for (size_t thread_count : {1u, 2u, 4u, 7u}) {
+        auto parallel = MakeAggregators(kinds);
+        ASSERT_EQUAL(ProcessParallel(*parallel, broken, thread_count), sequential_reader.Offset());
+        ASSERT_EQUAL(printed(*parallel), printed(*sequential));
+    }
+
+    // Кусков больше, чем чисел: лишние пустые
+    auto tiny = MakeAggregators(kinds_of({"sum"}));
+    ASSERT_EQUAL(ProcessParallel(*tiny, " 1 2", 8), 4u);
+    ASSERT_EQUAL(printed(*tiny), "Sum is 3\n");
+
+    ASSERT(!CanProcessInParallel(kinds_of({"sum", "p50"}), {}));
+    ASSERT(!CanProcessInParallel(kinds_of({"mode~"}), {}));
+    ASSERT(!CanProcessInParallel(kinds_of({"sum"}), {{"--sample", "0.5"}}));
+    ASSERT(CanProcessInParallel(kinds_of({"sum"}), {{"--filter", ">0"}, {"--map", "*2"}}));
+}
+
+void TestParseOptions() {
+    auto parse = [](vector<const char *> args) {
+        args.insert(args.begin(), "courseraRedBelt");
+        return ParseOptions(static_cast<int>(args.size()), args.data());
+    };
+    auto assert_rejected = [&parse](const vector<const char *> &args, const string &hint) {
+        try {
+            parse(args);
+            Assert(false, "ParseOptions() should throw std::invalid_argument for " + hint);
+        } catch (invalid_argument &) {
+        }
+    };
+
+    const Options options = parse({"--threads", "4", "--filter", ">0", "--map", "*2", "--input", "data.txt"});
+    ASSERT_EQUAL(options.thread_count, 4u);
+    ASSERT_EQUAL(options.input_path, "data.txt");
+    ASSERT_EQUAL(options.stage_args.size(), 2u);
+    ASSERT(parse({"--group-by"}).group_by);
+
+    assert_rejected({"--columnar", "data.col", "--group-by"}, "--columnar with --group-by");
+    assert_rejected({"--columnar", "data.col", "--threads", "2"}, "--columnar with --threads");
+    assert_rejected({"--group-by", "--filter", ">0"}, "--group-by with --filter");
+    assert_rejected({"--map", "*3", "--group-by"}, "--group-by with --map");
+    assert_rejected({"--group-by", "--sample", "0.5"}, "--group-by with --sample");
+    assert_rejected({"--group-by", "--timestamped"}, "--group-by with --timestamped");
+    assert_rejected({"--threads", "2", "--group-by"}, "--group-by with --threads");
+    assert_rejected({"--group-by", "--checkpoint", "state.bin"}, "--group-by with --checkpoint");
+    ASSERT(parse({"--group-by", "--threads", "1"}).group_by);
+    assert_rejected({"--checkpoint", "state.bin", "--sample", "0.1"}, "--checkpoint with --sample");
+    ASSERT_EQUAL(parse({"--checkpoint", "state.bin", "--filter", ">0"}).checkpoint_path, "state.bin");
+}
+
 void TestAll() {
     TestRunner tr;
     RUN_TEST(tr, TestSum);
@@ -56,5 +628,27 @@ void TestAll() {
     RUN_TEST(tr, TestMax);
     RUN_TEST(tr, TestAverage);
     RUN_TEST(tr, TestMode);
+    RUN_TEST(tr, TestModeDense);
+    RUN_TEST(tr, TestApproximateMode);
+    RUN_TEST(tr, TestQuantile);
+    RUN_TEST(tr, TestDistinct);
     RUN_TEST(tr, TestComposite);
+    RUN_TEST(tr, TestProcessBatch);
+    RUN_TEST(tr, TestStaticComposite);
+    RUN_TEST(tr, TestMerge);
+    RUN_TEST(tr, TestIntReader);
+    RUN_TEST(tr, TestColumnFile);
+    RUN_TEST(tr, TestWindowedSum);
+    RUN_TEST(tr, TestWindowedMinMax);
+    RUN_TEST(tr, TestWindowedMode);
+    RUN_TEST(tr, TestWindowedByTime);
+    RUN_TEST(tr, TestWindowedMerge);
+    RUN_TEST(tr, TestGroupedStats);
+    RUN_TEST(tr, TestSaveState);
+    RUN_TEST(tr, TestWindowedState);
+    RUN_TEST(tr, TestCheckpoint);
+    RUN_TEST(tr, TestPipeline);
+    RUN_TEST(tr, TestFusedPipeline);
+    RUN_TEST(tr, TestProcessParallel);
+    RUN_TEST(tr, TestParseOptions);
 }
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include "mapped_file.h"
+
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw system_error(errno, generic_category(), "open " + path);
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) < 0) {
+        int error = errno;
+        close(fd);
+        throw system_error(error, generic_category(), "fstat " + path);
+    }
+
+    size = static_cast<size_t>(st.st_size);
+    if (size > 0) {
+        void *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            int error = errno;
+            close(fd);
+            throw system_error(error, generic_category(), "mmap " + path);
+        }
+        madvise(addr, size, MADV_SEQUENTIAL);
+        data = static_cast<const char *>(addr);
+    }
+    close(fd);
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+        : data(exchange(other.data, nullptr)), size(exchange(other.size, 0)) {
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        Unmap();
+        data = exchange(other.data, nullptr);
+        size = exchange(other.size, 0);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    Unmap();
+}
+
+string_view MappedFile::Data() const {
+    return {data, size};
+}
+
+void MappedFile::Unmap() {
+    if (data != nullptr) {
+        munmap(const_cast<char *>(data), size);
+        data = nullptr;
+        size = 0;
+    }
+}
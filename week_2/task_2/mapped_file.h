@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+// Файл, целиком отображённый в память только для чтения.
+// Адрес отображения не меняется при перемещении объекта, поэтому
+// string_view, указывающие внутрь Data(), остаются валидными.
+class MappedFile {
+public:
+    explicit MappedFile(const string &path);
+
+    MappedFile(MappedFile &&other) noexcept;
+
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile();
+
+    string_view Data() const;
+
+private:
+    void Unmap();
+
+    const char *data = nullptr;
+    size_t size = 0;
+};
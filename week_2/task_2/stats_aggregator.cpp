@@ -1,4 +1,18 @@
 #include "stats_aggregator.h"
+#include "stats_state.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <unordered_set>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
@@ -14,12 +28,254 @@ ostream &operator<<(ostream &os, const optional<T> &v) {
 
 namespace StatsAggregators {
 
+    namespace {
+        // Сумма по модулю 2^32, как и при переполнении int на всех наших платформах;
+        // беззнаковая арифметика делает это поведение определённым
+        uint32_t WrappingAdd(uint32_t lhs, int rhs) {
+            return lhs + static_cast<uint32_t>(rhs);
+        }
+
+        template<typename T>
+        const T &SameType(const StatsAggregator &other) {
+            const auto *result = dynamic_cast<const T *>(&other);
+            if (result == nullptr) {
+                throw invalid_argument("StatsAggregator::Merge: aggregators of different types");
+            }
+            return *result;
+        }
+
+        void WriteOptional(string &out, const optional<int> &value) {
+            WriteUnsigned(out, value.has_value());
+            if (value) {
+                WriteSigned(out, *value);
+            }
+        }
+
+        optional<int> ReadOptional(string_view &in) {
+            const uint64_t has_value = ReadUnsigned(in);
+            if (has_value > 1) {
+                throw invalid_argument("StatsAggregator::LoadState: bad optional flag");
+            }
+            return has_value ? optional<int>(ReadInt(in)) : nullopt;
+        }
+
+        uint32_t SumKernel(const int *values, size_t count) {
+            size_t i = 0;
+            uint32_t result = 0;
+#if defined(__AVX2__)
+            __m256i acc = _mm256_setzero_si256();
+            for (; i + 8 <= count; i += 8) {
+                acc = _mm256_add_epi32(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i)));
+            }
+            alignas(32) uint32_t lanes[8];
+            _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), acc);
+            for (uint32_t lane : lanes) {
+                result += lane;
+            }
+#elif defined(__SSE2__)
+            __m128i acc = _mm_setzero_si128();
+            for (; i + 4 <= count; i += 4) {
+                acc = _mm_add_epi32(acc, _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i)));
+            }
+            alignas(16) uint32_t lanes[4];
+            _mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc);
+            for (uint32_t lane : lanes) {
+                result += lane;
+            }
+#endif
+            for (; i < count; ++i) {
+                result = WrappingAdd(result, values[i]);
+            }
+            return result;
+        }
+
+#if defined(__SSE2__) && !defined(__SSE4_1__)
+        // В SSE2 нет pminsd/pmaxsd, поэтому выбираем через сравнение и маску
+        inline __m128i Select(__m128i mask, __m128i if_true, __m128i if_false) {
+            return _mm_or_si128(_mm_and_si128(mask, if_true), _mm_andnot_si128(mask, if_false));
+        }
+#endif
+
+        // count > 0
+        template<bool IsMin>
+        int ExtremumKernel(const int *values, size_t count) {
+            auto better = [](int lhs, int rhs) {
+                return IsMin ? min(lhs, rhs) : max(lhs, rhs);
+            };
+
+            size_t i = 0;
+            int result = values[0];
+#if defined(__AVX2__)
+            if (count >= 8) {
+                __m256i acc = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values));
+                for (i = 8; i + 8 <= count; i += 8) {
+                    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i));
+                    acc = IsMin ? _mm256_min_epi32(acc, block) : _mm256_max_epi32(acc, block);
+                }
+                alignas(32) int lanes[8];
+                _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), acc);
+                for (int lane : lanes) {
+                    result = better(result, lane);
+                }
+            }
+#elif defined(__SSE2__)
+            if (count >= 4) {
+                __m128i acc = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values));
+                for (i = 4; i + 4 <= count; i += 4) {
+                    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i));
+#if defined(__SSE4_1__)
+                    acc = IsMin ? _mm_min_epi32(acc, block) : _mm_max_epi32(acc, block);
+#else
+                    acc = IsMin ? Select(_mm_cmplt_epi32(block, acc), block, acc)
+                                : Select(_mm_cmpgt_epi32(block, acc), block, acc);
+#endif
+                }
+                alignas(16) int lanes[4];
+                _mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc);
+                for (int lane : lanes) {
+                    result = better(result, lane);
+                }
+            }
+#endif
+            for (; i < count; ++i) {
+                result = better(result, values[i]);
+            }
+            return result;
+        }
+    }
+
+    BlockSummary SummarizeBlock(const int *values, size_t count) {
+        BlockSummary result;
+        result.min = result.max = values[0];
+        result.count = count;
+
+        size_t i = 0;
+#if defined(__AVX2__)
+        if (count >= 8) {
+            __m256i sum = _mm256_setzero_si256();
+            __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values));
+            __m256i high = low;
+            for (; i + 8 <= count; i += 8) {
+                const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i));
+                sum = _mm256_add_epi32(sum, block);
+                low = _mm256_min_epi32(low, block);
+                high = _mm256_max_epi32(high, block);
+            }
+            alignas(32) int lanes[3][8];
+            _mm256_store_si256(reinterpret_cast<__m256i *>(lanes[0]), sum);
+            _mm256_store_si256(reinterpret_cast<__m256i *>(lanes[1]), low);
+            _mm256_store_si256(reinterpret_cast<__m256i *>(lanes[2]), high);
+            for (size_t lane = 0; lane < 8; ++lane) {
+                result.sum = WrappingAdd(result.sum, lanes[0][lane]);
+                result.min = min(result.min, lanes[1][lane]);
+                result.max = max(result.max, lanes[2][lane]);
+            }
+        }
+#elif defined(__SSE2__)
+        if (count >= 4) {
+            __m128i sum = _mm_setzero_si128();
+            __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values));
+            __m128i high = low;
+            for (; i + 4 <= count; i += 4) {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i));
+                sum = _mm_add_epi32(sum, block);
+#if defined(__SSE4_1__)
+                low = _mm_min_epi32(low, block);
+                high = _mm_max_epi32(high, block);
+#else
+                low = Select(_mm_cmplt_epi32(block, low), block, low);
+                high = Select(_mm_cmpgt_epi32(block, high), block, high);
+#endif
+            }
+            alignas(16) int lanes[3][4];
+            _mm_store_si128(reinterpret_cast<__m128i *>(lanes[0]), sum);
+            _mm_store_si128(reinterpret_cast<__m128i *>(lanes[1]), low);
+            _mm_store_si128(reinterpret_cast<__m128i *>(lanes[2]), high);
+            for (size_t lane = 0; lane < 4; ++lane) {
+                result.sum = WrappingAdd(result.sum, lanes[0][lane]);
+                result.min = min(result.min, lanes[1][lane]);
+                result.max = max(result.max, lanes[2][lane]);
+            }
+        }
+#endif
+        for (; i < count; ++i) {
+            result.sum = WrappingAdd(result.sum, values[i]);
+            result.min = min(result.min, values[i]);
+            result.max = max(result.max, values[i]);
+        }
+        return result;
+    }
+
     void Composite::Process(int value) {
         for (auto &aggr: aggregators) {
             aggr->Process(value);
         }
     }
 
+    // Блок целиком уходит в каждый агрегатор: один виртуальный вызов
+    // на агрегатор и блок вместо вызова на каждое значение
+    void Composite::ProcessBatch(const int *values, size_t count) {
+        for (auto &aggr: aggregators) {
+            aggr->ProcessBatch(values, count);
+        }
+    }
+
+    void Composite::ProcessAt(int64_t timestamp, int value) {
+        for (auto &aggr: aggregators) {
+            aggr->ProcessAt(timestamp, value);
+        }
+    }
+
+    Composite::Composite(const Composite &other) {
+        for (const auto &aggr: other.aggregators) {
+            aggregators.push_back(aggr->Clone());
+        }
+    }
+
+    Composite &Composite::operator=(const Composite &other) {
+        if (this != &other) {
+            Composite copy(other);
+            aggregators = move(copy.aggregators);
+        }
+        return *this;
+    }
+
+    unique_ptr<StatsAggregator> Composite::Clone() const {
+        return make_unique<Composite>(*this);
+    }
+
+    void Composite::Merge(const StatsAggregator &other) {
+        const auto &same = SameType<Composite>(other);
+        if (same.aggregators.size() != aggregators.size()) {
+            throw invalid_argument("Composite::Merge: different number of aggregators");
+        }
+        for (size_t i = 0; i < aggregators.size(); ++i) {
+            aggregators[i]->Merge(*same.aggregators[i]);
+        }
+    }
+
+    void Composite::SaveState(string &out) const {
+        WriteTag(out, StateTag::Composite);
+        WriteUnsigned(out, aggregators.size());
+        for (const auto &aggr: aggregators) {
+            aggr->SaveState(out);
+        }
+    }
+
+    // Части читаются в копию, чтобы ошибка в середине не оставила
+    // агрегатор наполовину восстановленным
+    void Composite::LoadState(string_view &in) {
+        ReadTag(in, StateTag::Composite);
+        if (ReadUnsigned(in) != aggregators.size()) {
+            throw invalid_argument("Composite::LoadState: different number of aggregators");
+        }
+        Composite loaded(*this);
+        for (auto &aggr: loaded.aggregators) {
+            aggr->LoadState(in);
+        }
+        aggregators = move(loaded.aggregators);
+    }
+
     void Composite::PrintValue(std::ostream &output) const {
         for (const auto &aggr: aggregators) {
             aggr->PrintValue(output);
@@ -32,7 +288,33 @@ namespace StatsAggregators {
     }
 
     void Sum::Process(int value) {
-        sum += value;
+        sum = static_cast<int>(WrappingAdd(sum, value));
+    }
+
+    void Sum::ProcessBatch(const int *values, size_t count) {
+        sum = static_cast<int>(static_cast<uint32_t>(sum) + SumKernel(values, count));
+    }
+
+    void Sum::ProcessSummary(const BlockSummary &summary) {
+        sum = static_cast<int>(static_cast<uint32_t>(sum) + summary.sum);
+    }
+
+    unique_ptr<StatsAggregator> Sum::Clone() const {
+        return make_unique<Sum>(*this);
+    }
+
+    void Sum::Merge(const StatsAggregator &other) {
+        Sum::Process(SameType<Sum>(other).sum);
+    }
+
+    void Sum::SaveState(string &out) const {
+        WriteTag(out, StateTag::Sum);
+        WriteSigned(out, sum);
+    }
+
+    void Sum::LoadState(string_view &in) {
+        ReadTag(in, StateTag::Sum);
+        sum = ReadInt(in);
     }
 
     void Sum::PrintValue(std::ostream &out) const {
@@ -45,6 +327,36 @@ namespace StatsAggregators {
         }
     }
 
+    void Min::ProcessBatch(const int *values, size_t count) {
+        if (count > 0) {
+            Min::Process(ExtremumKernel<true>(values, count));
+        }
+    }
+
+    void Min::ProcessSummary(const BlockSummary &summary) {
+        Min::Process(summary.min);
+    }
+
+    unique_ptr<StatsAggregator> Min::Clone() const {
+        return make_unique<Min>(*this);
+    }
+
+    void Min::Merge(const StatsAggregator &other) {
+        if (const auto &other_min = SameType<Min>(other).current_min) {
+            Min::Process(*other_min);
+        }
+    }
+
+    void Min::SaveState(string &out) const {
+        WriteTag(out, StateTag::Min);
+        WriteOptional(out, current_min);
+    }
+
+    void Min::LoadState(string_view &in) {
+        ReadTag(in, StateTag::Min);
+        current_min = ReadOptional(in);
+    }
+
     void Min::PrintValue(std::ostream &out) const {
         out << "Min is " << current_min;
     }
@@ -55,15 +367,82 @@ namespace StatsAggregators {
         }
     }
 
+    void Max::ProcessBatch(const int *values, size_t count) {
+        if (count > 0) {
+            Max::Process(ExtremumKernel<false>(values, count));
+        }
+    }
+
+    void Max::ProcessSummary(const BlockSummary &summary) {
+        Max::Process(summary.max);
+    }
+
+    unique_ptr<StatsAggregator> Max::Clone() const {
+        return make_unique<Max>(*this);
+    }
+
+    void Max::Merge(const StatsAggregator &other) {
+        if (const auto &other_max = SameType<Max>(other).current_max) {
+            Max::Process(*other_max);
+        }
+    }
+
+    void Max::SaveState(string &out) const {
+        WriteTag(out, StateTag::Max);
+        WriteOptional(out, current_max);
+    }
+
+    void Max::LoadState(string_view &in) {
+        ReadTag(in, StateTag::Max);
+        current_max = ReadOptional(in);
+    }
+
     void Max::PrintValue(std::ostream &out) const {
         out << "Max is " << current_max;
     }
 
     void Average::Process(int value) {
-        sum += value;
+        sum = static_cast<int>(WrappingAdd(sum, value));
         ++total;
     }
 
+    void Average::ProcessBatch(const int *values, size_t count) {
+        sum = static_cast<int>(static_cast<uint32_t>(sum) + SumKernel(values, count));
+        total += static_cast<int64_t>(count);
+    }
+
+    void Average::ProcessSummary(const BlockSummary &summary) {
+        sum = static_cast<int>(static_cast<uint32_t>(sum) + summary.sum);
+        total += static_cast<int64_t>(summary.count);
+    }
+
+    unique_ptr<StatsAggregator> Average::Clone() const {
+        return make_unique<Average>(*this);
+    }
+
+    void Average::Merge(const StatsAggregator &other) {
+        const auto &same = SameType<Average>(other);
+        sum = static_cast<int>(WrappingAdd(sum, same.sum));
+        total += same.total;
+    }
+
+    void Average::SaveState(string &out) const {
+        WriteTag(out, StateTag::Average);
+        WriteSigned(out, sum);
+        WriteSigned(out, total);
+    }
+
+    void Average::LoadState(string_view &in) {
+        ReadTag(in, StateTag::Average);
+        const int loaded_sum = ReadInt(in);
+        const int64_t loaded_total = ReadSigned(in);
+        if (loaded_total < 0) {
+            throw invalid_argument("Average::LoadState: negative count");
+        }
+        sum = loaded_sum;
+        total = loaded_total;
+    }
+
     void Average::PrintValue(std::ostream &out) const {
         out << "Average is ";
         if (total == 0) {
@@ -73,15 +452,847 @@ namespace StatsAggregators {
         }
     }
 
+    Mode::Entry &Mode::At(int value) {
+        if (!sparse) {
+            const int64_t offset = int64_t(value) - dense_base;
+            if (offset >= 0 && offset < int64_t(dense.size())) {
+                return dense[offset];
+            }
+            if (GrowDense(value)) {
+                return dense[int64_t(value) - dense_base];
+            }
+        }
+        return count[value];
+    }
+
+    bool Mode::GrowDense(int value) {
+        if (dense.empty()) {
+            dense.resize(4);
+            dense_base = value;
+            return true;
+        }
+
+        const int64_t low = min<int64_t>(dense_base, value);
+        const int64_t high = max<int64_t>(dense_base + dense.size(), int64_t(value) + 1);
+        if (high - low > int64_t(DENSE_LIMIT)) {
+            for (size_t i = 0; i < dense.size(); ++i) {
+                if (dense[i].count > 0) {
+                    count.emplace(static_cast<int>(dense_base + i), dense[i]);
+                }
+            }
+            dense = {};
+            sparse = true;
+            return false;
+        }
+
+        // Массив растёт хотя бы вдвое в сторону нового значения,
+        // чтобы перенос счётчиков оставался амортизированно дешёвым
+        const int64_t new_size = min<int64_t>(DENSE_LIMIT, max<int64_t>(high - low, 2 * dense.size()));
+        const int64_t new_base = value < dense_base ? high - new_size : low;
+        vector<Entry> grown(new_size);
+        copy(dense.begin(), dense.end(), grown.begin() + (dense_base - new_base));
+        dense = move(grown);
+        dense_base = new_base;
+        return true;
+    }
+
+    template<typename Func>
+    void Mode::ForEachEntry(Func func) const {
+        for (size_t i = 0; i < dense.size(); ++i) {
+            if (dense[i].count > 0) {
+                func(static_cast<int>(dense_base + i), dense[i]);
+            }
+        }
+        for (const auto &[value, entry] : count) {
+            func(value, entry);
+        }
+    }
+
     void Mode::Process(int value) {
-        int current_count = ++count[value];
-        if (!mode || current_count > count[*mode]) {
+        Entry &entry = At(value);
+        ++entry.count;
+        entry.last_seen = ++processed;
+        if (!mode || entry.count > mode_count) {
             mode = value;
+            mode_count = entry.count;
         }
     }
 
+    // Счётчики не векторизуются, но хотя бы вызов Process здесь не виртуальный
+    void Mode::ProcessBatch(const int *values, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            Mode::Process(values[i]);
+        }
+    }
+
+    unique_ptr<StatsAggregator> Mode::Clone() const {
+        return make_unique<Mode>(*this);
+    }
+
+    void Mode::Merge(const StatsAggregator &other) {
+        const auto &same = SameType<Mode>(other);
+        same.ForEachEntry([this, &same](int value, const Entry &other_entry) {
+            Entry &entry = At(value);
+            entry.count += other_entry.count;
+            entry.last_seen = processed + other_entry.last_seen;
+        });
+        processed += same.processed;
+        RecomputeMode();
+    }
+
+    void Mode::RecomputeMode() {
+        mode.reset();
+        mode_count = 0;
+        uint64_t mode_last_seen = 0;
+        ForEachEntry([this, &mode_last_seen](int value, const Entry &entry) {
+            if (entry.count > mode_count || (entry.count == mode_count && entry.last_seen < mode_last_seen)) {
+                mode = value;
+                mode_count = entry.count;
+                mode_last_seen = entry.last_seen;
+            }
+        });
+    }
+
+    // Мода не сохраняется: RecomputeMode выбирает ту же по счётчикам
+    void Mode::SaveState(string &out) const {
+        WriteTag(out, StateTag::Mode);
+        WriteUnsigned(out, processed);
+        size_t entry_count = 0;
+        ForEachEntry([&entry_count](int, const Entry &) { ++entry_count; });
+        WriteUnsigned(out, entry_count);
+        ForEachEntry([&out](int value, const Entry &entry) {
+            WriteSigned(out, value);
+            WriteUnsigned(out, entry.count);
+            WriteUnsigned(out, entry.last_seen);
+        });
+    }
+
+    void Mode::LoadState(string_view &in) {
+        ReadTag(in, StateTag::Mode);
+        Mode loaded;
+        loaded.processed = ReadUnsigned(in);
+        const uint64_t entry_count = ReadUnsigned(in);
+        for (uint64_t i = 0; i < entry_count; ++i) {
+            const int value = ReadInt(in);
+            const uint64_t count = ReadUnsigned(in);
+            const uint64_t last_seen = ReadUnsigned(in);
+            Entry &entry = loaded.At(value);
+            if (entry.count != 0 || count == 0 || count > INT_MAX || last_seen > loaded.processed) {
+                throw invalid_argument("Mode::LoadState: bad counter");
+            }
+            entry = {static_cast<int>(count), last_seen};
+        }
+        loaded.RecomputeMode();
+        *this = move(loaded);
+    }
+
     void Mode::PrintValue(std::ostream &out) const {
         out << "Mode is " << mode;
     }
 
-}
\ No newline at end of file
+    namespace {
+        // Фибоначчиево хеширование: соседние значения расходятся по таблице
+        size_t SlotHash(int value) {
+            return (static_cast<uint32_t>(value) * 0x9E3779B97F4A7C15ull) >> 32;
+        }
+    }
+
+    // На каждый счётчик приходятся сам Counter, не больше одной корзины
+    // и в худшем случае четыре ячейки таблицы
+    ApproximateMode::ApproximateMode(size_t memory_budget)
+            : capacity(max<size_t>(memory_budget / (sizeof(Counter) + sizeof(Bucket) + 4 * sizeof(uint32_t)), 1)) {
+        size_t slot_count = 2;
+        while (slot_count < 2 * capacity) {
+            slot_count *= 2;
+        }
+        slots.assign(slot_count, 0);
+    }
+
+    size_t ApproximateMode::FindSlot(int value) const {
+        const size_t mask = slots.size() - 1;
+        for (size_t i = SlotHash(value) & mask;; i = (i + 1) & mask) {
+            if (slots[i] == 0 || counters[slots[i] - 1].value == value) {
+                return i;
+            }
+        }
+    }
+
+    // Удаление со сдвигом назад: без надгробий цепочки не деградируют
+    // при постоянном вытеснении счётчиков
+    void ApproximateMode::EraseSlot(int value) {
+        const size_t mask = slots.size() - 1;
+        size_t hole = FindSlot(value);
+        slots[hole] = 0;
+        for (size_t i = (hole + 1) & mask; slots[i] != 0; i = (i + 1) & mask) {
+            const size_t home = SlotHash(counters[slots[i] - 1].value) & mask;
+            if (((i - home) & mask) >= ((i - hole) & mask)) {
+                slots[hole] = slots[i];
+                slots[i] = 0;
+                hole = i;
+            }
+        }
+    }
+
+    uint64_t ApproximateMode::Count(uint32_t counter) const {
+        return buckets[counters[counter].bucket].count;
+    }
+
+    uint32_t ApproximateMode::AddBucket(uint64_t count, uint32_t prev) {
+        uint32_t index;
+        if (!free_buckets.empty()) {
+            index = free_buckets.back();
+            free_buckets.pop_back();
+        } else {
+            index = static_cast<uint32_t>(buckets.size());
+            buckets.emplace_back();
+        }
+
+        Bucket &bucket = buckets[index];
+        bucket.count = count;
+        bucket.first = NONE;
+        bucket.prev = prev;
+        bucket.next = prev == NONE ? min_bucket : buckets[prev].next;
+        if (bucket.next != NONE) {
+            buckets[bucket.next].prev = index;
+        }
+        if (prev == NONE) {
+            min_bucket = index;
+        } else {
+            buckets[prev].next = index;
+        }
+        return index;
+    }
+
+    void ApproximateMode::Link(uint32_t counter, uint32_t bucket) {
+        Counter &linked = counters[counter];
+        linked.bucket = bucket;
+        linked.prev = NONE;
+        linked.next = buckets[bucket].first;
+        if (linked.next != NONE) {
+            counters[linked.next].prev = counter;
+        }
+        buckets[bucket].first = counter;
+    }
+
+    void ApproximateMode::Unlink(uint32_t counter) {
+        const Counter &unlinked = counters[counter];
+        if (unlinked.prev != NONE) {
+            counters[unlinked.prev].next = unlinked.next;
+        } else {
+            buckets[unlinked.bucket].first = unlinked.next;
+        }
+        if (unlinked.next != NONE) {
+            counters[unlinked.next].prev = unlinked.prev;
+        }
+
+        const uint32_t index = unlinked.bucket;
+        const Bucket &bucket = buckets[index];
+        if (bucket.first != NONE) {
+            return;
+        }
+        if (bucket.prev != NONE) {
+            buckets[bucket.prev].next = bucket.next;
+        } else {
+            min_bucket = bucket.next;
+        }
+        if (bucket.next != NONE) {
+            buckets[bucket.next].prev = bucket.prev;
+        }
+        free_buckets.push_back(index);
+    }
+
+    void ApproximateMode::Increment(uint32_t counter) {
+        const uint32_t bucket = counters[counter].bucket;
+        const uint64_t count = buckets[bucket].count + 1;
+        uint32_t next = buckets[bucket].next;
+        if (next == NONE || buckets[next].count != count) {
+            next = AddBucket(count, bucket);
+        }
+        Unlink(counter);
+        Link(counter, next);
+    }
+
+    void ApproximateMode::Process(int value) {
+        const size_t slot = FindSlot(value);
+        uint32_t counter;
+        if (slots[slot] != 0) {
+            counter = slots[slot] - 1;
+            Increment(counter);
+        } else if (counters.size() < capacity) {
+            counter = static_cast<uint32_t>(counters.size());
+            counters.emplace_back();
+            counters[counter].value = value;
+            slots[slot] = counter + 1;
+            const bool has_ones = min_bucket != NONE && buckets[min_bucket].count == 1;
+            Link(counter, has_ones ? min_bucket : AddBucket(1, NONE));
+        } else {
+            // Значение занимает счётчик с наименьшей частотой
+            counter = buckets[min_bucket].first;
+            EraseSlot(counters[counter].value);
+            counters[counter].value = value;
+            counters[counter].error = buckets[min_bucket].count;
+            slots[FindSlot(value)] = counter + 1;
+            Increment(counter);
+        }
+
+        counters[counter].last_seen = ++processed;
+        const uint64_t count = Count(counter);
+        if (!mode || count > mode_count) {
+            mode = value;
+            mode_count = count;
+        }
+    }
+
+    void ApproximateMode::ProcessBatch(const int *values, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            ApproximateMode::Process(values[i]);
+        }
+    }
+
+    unique_ptr<StatsAggregator> ApproximateMode::Clone() const {
+        return make_unique<ApproximateMode>(*this);
+    }
+
+    // Значение, которого нет в заполненной сводке, могло встретиться в ней
+    // не больше минимального её счётчика раз; эта величина добавляется
+    // и к частоте, и к ошибке, после чего остаются capacity самых частых
+    void ApproximateMode::Merge(const StatsAggregator &other) {
+        const auto &same = SameType<ApproximateMode>(other);
+        const uint64_t own_min = counters.size() < capacity ? 0 : buckets[min_bucket].count;
+        const uint64_t other_min = same.counters.size() < same.capacity ? 0 : same.buckets[same.min_bucket].count;
+
+        vector<pair<uint64_t, Counter>> merged;
+        merged.reserve(counters.size() + same.counters.size());
+        for (uint32_t i = 0; i < counters.size(); ++i) {
+            Counter counter = counters[i];
+            uint64_t count = Count(i);
+            const uint32_t other_slot = same.slots[same.FindSlot(counter.value)];
+            if (other_slot != 0) {
+                const Counter &other_counter = same.counters[other_slot - 1];
+                count += same.Count(other_slot - 1);
+                counter.error += other_counter.error;
+                counter.last_seen = processed + other_counter.last_seen;
+            } else {
+                count += other_min;
+                counter.error += other_min;
+            }
+            merged.emplace_back(count, counter);
+        }
+        for (uint32_t i = 0; i < same.counters.size(); ++i) {
+            Counter counter = same.counters[i];
+            if (slots[FindSlot(counter.value)] == 0) {
+                counter.error += own_min;
+                counter.last_seen += processed;
+                merged.emplace_back(same.Count(i) + own_min, counter);
+            }
+        }
+        processed += same.processed;
+        Rebuild(move(merged));
+    }
+
+    void ApproximateMode::Rebuild(vector<pair<uint64_t, Counter>> entries) {
+        auto by_count = [](const auto &lhs, const auto &rhs) { return lhs.first > rhs.first; };
+        if (entries.size() > capacity) {
+            nth_element(entries.begin(), entries.begin() + capacity, entries.end(), by_count);
+            entries.resize(capacity);
+        }
+        sort(entries.begin(), entries.end(), by_count);
+
+        counters.clear();
+        buckets.clear();
+        free_buckets.clear();
+        min_bucket = NONE;
+        fill(slots.begin(), slots.end(), 0);
+        mode.reset();
+        mode_count = 0;
+        uint64_t mode_last_seen = 0;
+        // Корзины создаются от больших частот к меньшим, каждая в начале списка
+        for (const auto &[count, entry] : entries) {
+            const auto counter = static_cast<uint32_t>(counters.size());
+            counters.push_back(entry);
+            slots[FindSlot(entry.value)] = counter + 1;
+            if (min_bucket == NONE || buckets[min_bucket].count != count) {
+                AddBucket(count, NONE);
+            }
+            Link(counter, min_bucket);
+
+            if (count > mode_count || (count == mode_count && entry.last_seen < mode_last_seen)) {
+                mode = entry.value;
+                mode_count = count;
+                mode_last_seen = entry.last_seen;
+            }
+        }
+    }
+
+    void ApproximateMode::SaveState(string &out) const {
+        WriteTag(out, StateTag::ApproximateMode);
+        WriteUnsigned(out, capacity);
+        WriteUnsigned(out, processed);
+        WriteUnsigned(out, counters.size());
+        for (uint32_t i = 0; i < counters.size(); ++i) {
+            WriteSigned(out, counters[i].value);
+            WriteUnsigned(out, Count(i));
+            WriteUnsigned(out, counters[i].error);
+            WriteUnsigned(out, counters[i].last_seen);
+        }
+    }
+
+    void ApproximateMode::LoadState(string_view &in) {
+        ReadTag(in, StateTag::ApproximateMode);
+        if (ReadUnsigned(in) != capacity) {
+            throw invalid_argument("ApproximateMode::LoadState: different capacity");
+        }
+        const uint64_t loaded_processed = ReadUnsigned(in);
+        const uint64_t counter_count = ReadUnsigned(in);
+        if (counter_count > capacity) {
+            throw invalid_argument("ApproximateMode::LoadState: too many counters");
+        }
+
+        vector<pair<uint64_t, Counter>> entries(counter_count);
+        unordered_set<int> seen;
+        for (auto &[count, entry] : entries) {
+            entry.value = ReadInt(in);
+            count = ReadUnsigned(in);
+            entry.error = ReadUnsigned(in);
+            entry.last_seen = ReadUnsigned(in);
+            if (!seen.insert(entry.value).second || count == 0 || entry.error >= count
+                || entry.last_seen > loaded_processed) {
+                throw invalid_argument("ApproximateMode::LoadState: bad counter");
+            }
+        }
+
+        processed = loaded_processed;
+        Rebuild(move(entries));
+    }
+
+    size_t ApproximateMode::Capacity() const {
+        return capacity;
+    }
+
+    uint64_t ApproximateMode::ErrorBound() const {
+        uint64_t result = 0;
+        for (const Counter &counter : counters) {
+            result = max(result, counter.error);
+        }
+        return result;
+    }
+
+    void ApproximateMode::PrintValue(std::ostream &out) const {
+        out << "Approximate mode is " << mode;
+    }
+
+    namespace {
+        // Финализатор MurmurHash3 — биекция на 64-битных числах, а значение
+        // с выставленным 32-м битом никогда не даёт 0
+        uint64_t DistinctHash(int value) {
+            uint64_t x = uint64_t(static_cast<uint32_t>(value)) | (uint64_t(1) << 32);
+            x ^= x >> 33;
+            x *= 0xFF51AFD7ED558CCDull;
+            x ^= x >> 33;
+            x *= 0xC4CEB9FE1A85EC53ull;
+            x ^= x >> 33;
+            return x;
+        }
+
+        void RegisterMaxKernel(uint8_t *registers, const uint8_t *other, size_t count) {
+            size_t i = 0;
+#if defined(__AVX2__)
+            for (; i + 32 <= count; i += 32) {
+                __m256i lhs = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(registers + i));
+                __m256i rhs = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(other + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(registers + i), _mm256_max_epu8(lhs, rhs));
+            }
+#elif defined(__SSE2__)
+            for (; i + 16 <= count; i += 16) {
+                __m128i lhs = _mm_loadu_si128(reinterpret_cast<const __m128i *>(registers + i));
+                __m128i rhs = _mm_loadu_si128(reinterpret_cast<const __m128i *>(other + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(registers + i), _mm_max_epu8(lhs, rhs));
+            }
+#endif
+            for (; i < count; ++i) {
+                registers[i] = max(registers[i], other[i]);
+            }
+        }
+    }
+
+    Distinct::Distinct(int precision) : precision(precision) {
+        if (precision < MIN_PRECISION || precision > MAX_PRECISION) {
+            throw invalid_argument("Distinct: precision out of range");
+        }
+    }
+
+    void Distinct::AddToRegisters(uint64_t hash) {
+        const size_t index = hash >> (64 - precision);
+        // Ранг — позиция первой единицы в оставшихся битах; ограничитель
+        // в младшем бите не даёт ему превысить 64 - precision + 1
+        const uint64_t rest = (hash << precision) | (uint64_t(1) << (precision - 1));
+        const auto rank = static_cast<uint8_t>(__builtin_clzll(rest) + 1);
+        registers[index] = max(registers[index], rank);
+    }
+
+    void Distinct::SwitchToRegisters() {
+        registers.assign(size_t(1) << precision, 0);
+        for (uint64_t hash : exact) {
+            if (hash != 0) {
+                AddToRegisters(hash);
+            }
+        }
+        exact = {};
+        exact_count = 0;
+    }
+
+    void Distinct::AddHash(uint64_t hash) {
+        if (!registers.empty()) {
+            AddToRegisters(hash);
+            return;
+        }
+
+        if (!exact.empty()) {
+            const size_t mask = exact.size() - 1;
+            size_t i = hash & mask;
+            while (exact[i] != 0 && exact[i] != hash) {
+                i = (i + 1) & mask;
+            }
+            if (exact[i] == hash) {
+                return;
+            }
+        }
+
+        if ((exact_count + 1) * 2 > exact.size()) {
+            if (exact_count + 1 > (size_t(1) << precision) / 16) {
+                SwitchToRegisters();
+                AddToRegisters(hash);
+                return;
+            }
+            vector<uint64_t> old = move(exact);
+            exact.assign(max<size_t>(old.size() * 2, 8), 0);
+            for (uint64_t old_hash : old) {
+                if (old_hash != 0) {
+                    size_t i = old_hash & (exact.size() - 1);
+                    while (exact[i] != 0) {
+                        i = (i + 1) & (exact.size() - 1);
+                    }
+                    exact[i] = old_hash;
+                }
+            }
+        }
+
+        // Значения ещё нет в таблице, и место для него есть
+        const size_t mask = exact.size() - 1;
+        size_t i = hash & mask;
+        while (exact[i] != 0) {
+            i = (i + 1) & mask;
+        }
+        exact[i] = hash;
+        ++exact_count;
+    }
+
+    void Distinct::Process(int value) {
+        AddHash(DistinctHash(value));
+    }
+
+    void Distinct::ProcessBatch(const int *values, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            AddHash(DistinctHash(values[i]));
+        }
+    }
+
+    unique_ptr<StatsAggregator> Distinct::Clone() const {
+        return make_unique<Distinct>(*this);
+    }
+
+    void Distinct::Merge(const StatsAggregator &other) {
+        const auto &same = SameType<Distinct>(other);
+        if (same.precision != precision) {
+            throw invalid_argument("Distinct::Merge: different precision");
+        }
+        if (same.registers.empty()) {
+            for (uint64_t hash : same.exact) {
+                if (hash != 0) {
+                    AddHash(hash);
+                }
+            }
+            return;
+        }
+        if (registers.empty()) {
+            SwitchToRegisters();
+        }
+        RegisterMaxKernel(registers.data(), same.registers.data(), registers.size());
+    }
+
+    void Distinct::SaveState(string &out) const {
+        WriteTag(out, StateTag::Distinct);
+        WriteUnsigned(out, precision);
+        WriteUnsigned(out, registers.empty() ? exact_count : 0);
+        for (uint64_t hash : exact) {
+            if (hash != 0) {
+                WriteFixed64(out, hash);
+            }
+        }
+        // Регистры пишутся как есть: 2^precision байт
+        WriteUnsigned(out, !registers.empty());
+        out.append(reinterpret_cast<const char *>(registers.data()), registers.size());
+    }
+
+    void Distinct::LoadState(string_view &in) {
+        ReadTag(in, StateTag::Distinct);
+        if (ReadUnsigned(in) != uint64_t(precision)) {
+            throw invalid_argument("Distinct::LoadState: different precision");
+        }
+        Distinct loaded(precision);
+        const uint64_t hash_count = ReadUnsigned(in);
+        if (hash_count > (size_t(1) << precision) / 16) {
+            throw invalid_argument("Distinct::LoadState: too many exact values");
+        }
+        for (uint64_t i = 0; i < hash_count; ++i) {
+            const uint64_t hash = ReadFixed64(in);
+            if (hash == 0) {
+                throw invalid_argument("Distinct::LoadState: bad hash");
+            }
+            loaded.AddHash(hash);
+        }
+        const uint64_t has_registers = ReadUnsigned(in);
+        if (has_registers > 1 || (has_registers && hash_count > 0)) {
+            throw invalid_argument("Distinct::LoadState: bad mode");
+        }
+        if (has_registers) {
+            const string_view bytes = ReadBytes(in, size_t(1) << precision);
+            loaded.registers.assign(bytes.begin(), bytes.end());
+        }
+        *this = move(loaded);
+    }
+
+    uint64_t Distinct::Estimate() const {
+        if (registers.empty()) {
+            return exact_count;
+        }
+
+        const double m = double(registers.size());
+        double sum = 0;
+        size_t zeros = 0;
+        for (uint8_t reg : registers) {
+            sum += ldexp(1.0, -reg);
+            zeros += reg == 0;
+        }
+        const double alpha = 0.7213 / (1 + 1.079 / m);
+        const double estimate = alpha * m * m / sum;
+        // На малых мощностях точнее линейный подсчёт по пустым регистрам;
+        // 64-битному хешу поправка на больших мощностях не нужна
+        if (estimate <= 2.5 * m && zeros > 0) {
+            return llround(m * log(m / double(zeros)));
+        }
+        return llround(estimate);
+    }
+
+    void Distinct::PrintValue(std::ostream &out) const {
+        out << "Distinct is " << Estimate();
+    }
+
+    Quantile::Quantile(double quantile, size_t k) : quantile(quantile), k(max<size_t>(k, 2)) {
+        AddLevel();
+    }
+
+    // Верхний уровень вмещает k значений, каждый следующий вниз — в 2/3 раза меньше
+    size_t Quantile::LevelCapacity(size_t level) const {
+        const double depth = double(levels.size() - level - 1);
+        return max<size_t>(size_t(ceil(k * pow(2.0 / 3.0, depth))), 2);
+    }
+
+    void Quantile::AddLevel() {
+        levels.emplace_back();
+        max_size = 0;
+        for (size_t level = 0; level < levels.size(); ++level) {
+            max_size += LevelCapacity(level);
+        }
+        levels.back().reserve(LevelCapacity(levels.size() - 1));
+    }
+
+    void Quantile::Compress() {
+        for (size_t level = 0; level < levels.size(); ++level) {
+            if (levels[level].size() < LevelCapacity(level)) {
+                continue;
+            }
+            if (level + 1 == levels.size()) {
+                AddLevel();
+            }
+
+            // При нечётном размере наименьшее значение остаётся на месте;
+            // из каждой пары наверх уходит случайно выбранный элемент
+            vector<int> &current = levels[level];
+            sort(current.begin(), current.end());
+            random_state ^= random_state << 13;
+            random_state ^= random_state >> 7;
+            random_state ^= random_state << 17;
+            const size_t begin = current.size() % 2;
+            const size_t offset = random_state & 1;
+            for (size_t i = begin + offset; i < current.size(); i += 2) {
+                levels[level + 1].push_back(current[i]);
+            }
+            size -= (current.size() - begin) / 2;
+            current.resize(begin);
+            return;
+        }
+    }
+
+    void Quantile::Process(int value) {
+        levels[0].push_back(value);
+        if (++size >= max_size) {
+            Compress();
+        }
+    }
+
+    void Quantile::ProcessBatch(const int *values, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            Quantile::Process(values[i]);
+        }
+    }
+
+    unique_ptr<StatsAggregator> Quantile::Clone() const {
+        return make_unique<Quantile>(*this);
+    }
+
+    void Quantile::Merge(const StatsAggregator &other) {
+        const auto &same = SameType<Quantile>(other);
+        if (same.quantile != quantile) {
+            throw invalid_argument("Quantile::Merge: different quantiles");
+        }
+        while (levels.size() < same.levels.size()) {
+            AddLevel();
+        }
+        for (size_t level = 0; level < same.levels.size(); ++level) {
+            levels[level].insert(levels[level].end(), same.levels[level].begin(), same.levels[level].end());
+        }
+        size += same.size;
+        while (size >= max_size) {
+            const size_t before = size;
+            Compress();
+            if (size == before) {
+                break;
+            }
+        }
+    }
+
+    void Quantile::SaveState(string &out) const {
+        WriteTag(out, StateTag::Quantile);
+        uint64_t quantile_bits;
+        memcpy(&quantile_bits, &quantile, sizeof(quantile_bits));
+        WriteFixed64(out, quantile_bits);
+        WriteUnsigned(out, k);
+        WriteFixed64(out, random_state);
+        WriteUnsigned(out, levels.size());
+        for (const auto &level : levels) {
+            WriteUnsigned(out, level.size());
+            for (int value : level) {
+                WriteSigned(out, value);
+            }
+        }
+    }
+
+    void Quantile::LoadState(string_view &in) {
+        ReadTag(in, StateTag::Quantile);
+        const uint64_t quantile_bits = ReadFixed64(in);
+        double loaded_quantile;
+        memcpy(&loaded_quantile, &quantile_bits, sizeof(loaded_quantile));
+        if (loaded_quantile != quantile || ReadUnsigned(in) != k) {
+            throw invalid_argument("Quantile::LoadState: different quantile or k");
+        }
+
+        Quantile loaded(quantile, k);
+        loaded.random_state = ReadFixed64(in);
+        const uint64_t level_count = ReadUnsigned(in);
+        if (level_count == 0 || level_count > 64) {
+            throw invalid_argument("Quantile::LoadState: bad number of levels");
+        }
+        while (loaded.levels.size() < level_count) {
+            loaded.AddLevel();
+        }
+        for (size_t level = 0; level < level_count; ++level) {
+            const uint64_t level_size = ReadUnsigned(in);
+            for (uint64_t i = 0; i < level_size; ++i) {
+                loaded.levels[level].push_back(ReadInt(in));
+            }
+            loaded.size += level_size;
+        }
+        if (loaded.size >= loaded.max_size) {
+            throw invalid_argument("Quantile::LoadState: sketch overflow");
+        }
+        *this = move(loaded);
+    }
+
+    void Quantile::PrintValue(std::ostream &out) const {
+        out << "Percentile " << quantile * 100 << " is ";
+
+        vector<pair<int, uint64_t>> weighted;
+        weighted.reserve(size);
+        uint64_t total = 0;
+        for (size_t level = 0; level < levels.size(); ++level) {
+            for (int value : levels[level]) {
+                weighted.emplace_back(value, uint64_t(1) << level);
+            }
+            total += levels[level].size() << level;
+        }
+        if (total == 0) {
+            out << "undefined";
+            return;
+        }
+        sort(weighted.begin(), weighted.end());
+
+        // Поправка гасит погрешность вроде 0.29 * 100 = 28.999999999999996
+        const auto rank = max<uint64_t>(uint64_t(ceil(quantile * total - 1e-9)), 1);
+        uint64_t seen = 0;
+        for (const auto &[value, weight] : weighted) {
+            seen += weight;
+            if (seen >= rank) {
+                out << value;
+                return;
+            }
+        }
+        out << weighted.back().first;
+    }
+
+
+    template class StaticComposite<Sum, Min, Max, Average, Mode>;
+    template class StaticComposite<Sum, Min, Max, Average>;
+    template class StaticComposite<Min, Max>;
+    template class StaticComposite<Sum, Average>;
+
+    template<typename... Aggregators>
+    unique_ptr<StatsAggregator> MakeOrdered(const vector<size_t> &print_order) {
+        array<size_t, sizeof...(Aggregators)> order{};
+        copy(print_order.begin(), print_order.end(), order.begin());
+        return make_unique<StaticComposite<Aggregators...>>(order);
+    }
+
+    unique_ptr<StatsAggregator> MakeStaticComposite(const vector<string> &names) {
+        // Части каждого набора ниже идут в этом порядке
+        static const map<string, size_t> ranks = {{"sum", 0}, {"min", 1}, {"max", 2}, {"avg", 3}, {"mode", 4}};
+        using Builder = unique_ptr<StatsAggregator> (*)(const vector<size_t> &);
+        static const map<vector<string>, Builder> builders = {
+                {{"sum", "min", "max", "avg", "mode"}, MakeOrdered<Sum, Min, Max, Average, Mode>},
+                {{"sum", "min", "max", "avg"}, MakeOrdered<Sum, Min, Max, Average>},
+                {{"min", "max"}, MakeOrdered<Min, Max>},
+                {{"sum", "avg"}, MakeOrdered<Sum, Average>},
+        };
+
+        for (const string &name : names) {
+            if (ranks.count(name) == 0) {
+                return nullptr;
+            }
+        }
+        vector<string> canonical = names;
+        sort(canonical.begin(), canonical.end(), [](const string &lhs, const string &rhs) {
+            return ranks.at(lhs) < ranks.at(rhs);
+        });
+        auto it = builders.find(canonical);
+        if (it == builders.end()) {
+            return nullptr;
+        }
+
+        // Повторов в наборах нет, поэтому позиция имени однозначна
+        vector<size_t> print_order;
+        for (const string &name : names) {
+            print_order.push_back(find(canonical.begin(), canonical.end(), name) - canonical.begin());
+        }
+        return it->second(print_order);
+    }
+}
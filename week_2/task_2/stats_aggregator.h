@@ -1,10 +1,17 @@
 #pragma once
 
+#include <array>
 #include <ostream>
 #include <limits>
 #include <memory>
 #include <vector>
+#include <cstdint>
 #include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
 
 struct StatsAggregator {
@@ -13,17 +20,75 @@ struct StatsAggregator {
 
     virtual void Process(int value) = 0;
 
+    // Обрабатывает блок значений за один виртуальный вызов.
+    // Результат тот же, что у Process для каждого значения по порядку.
+    virtual void ProcessBatch(const int *values, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            Process(values[i]);
+        }
+    }
+
+    // Значение с меткой времени в секундах. Метка нужна только окнам
+    // по времени, остальные агрегаторы её игнорируют.
+    virtual void ProcessAt(int64_t /*timestamp*/, int value) {
+        Process(value);
+    }
+
     virtual void PrintValue(std::ostream &out) const = 0;
+
+    // Копия агрегатора вместе с текущим состоянием
+    virtual std::unique_ptr<StatsAggregator> Clone() const = 0;
+
+    // Добавляет состояние other так, как если бы его значения пришли
+    // в Process после значений этого агрегатора. other должен быть
+    // того же типа (для Composite — того же состава), иначе invalid_argument.
+    virtual void Merge(const StatsAggregator &other) = 0;
+
+    // Дописывает к out состояние агрегатора в компактном двоичном виде
+    // (см. stats_state.h), чтобы потом продолжить с того же места
+    virtual void SaveState(std::string &out) const = 0;
+
+    // Заменяет состояние на сохранённое SaveState агрегатора того же типа
+    // и с теми же параметрами и снимает прочитанное с начала in. Чужое
+    // или оборванное состояние приводит к invalid_argument, и тогда
+    // агрегатор остаётся прежним.
+    virtual void LoadState(std::string_view &in) = 0;
 };
 
 namespace StatsAggregators {
 
+    // Сумма блока по модулю 2^32, его минимум и максимум, посчитанные
+    // за один проход. Агрегаторы, которым хватает этих чисел, умеют
+    // принимать их через ProcessSummary вместо значений блока.
+    struct BlockSummary {
+        uint32_t sum = 0;
+        int min = 0;
+        int max = 0;
+        size_t count = 0;
+    };
+
+    // count > 0
+    BlockSummary SummarizeBlock(const int *values, size_t count);
+
     class Sum : public StatsAggregator {
     public:
         void Process(int value) override;
 
+        void ProcessBatch(const int *values, size_t count) override;
+
+        // То же, что ProcessBatch для блока с этой сводкой
+        void ProcessSummary(const BlockSummary &summary);
+
         void PrintValue(std::ostream &out) const override;
 
+        std::unique_ptr<StatsAggregator> Clone() const override;
+
+        void Merge(const StatsAggregator &other) override;
+
+        void SaveState(std::string &out) const override;
+
+        void LoadState(std::string_view &in) override;
+
     private:
         int sum = 0;
     };
@@ -32,8 +97,21 @@ namespace StatsAggregators {
     public:
         void Process(int value) override;
 
+        void ProcessBatch(const int *values, size_t count) override;
+
+        // То же, что ProcessBatch для блока с этой сводкой
+        void ProcessSummary(const BlockSummary &summary);
+
         void PrintValue(std::ostream &out) const override;
 
+        std::unique_ptr<StatsAggregator> Clone() const override;
+
+        void Merge(const StatsAggregator &other) override;
+
+        void SaveState(std::string &out) const override;
+
+        void LoadState(std::string_view &in) override;
+
     private:
         std::optional<int> current_min;
     };
@@ -42,8 +120,21 @@ namespace StatsAggregators {
     public:
         void Process(int value) override;
 
+        void ProcessBatch(const int *values, size_t count) override;
+
+        // То же, что ProcessBatch для блока с этой сводкой
+        void ProcessSummary(const BlockSummary &summary);
+
         void PrintValue(std::ostream &out) const override;
 
+        std::unique_ptr<StatsAggregator> Clone() const override;
+
+        void Merge(const StatsAggregator &other) override;
+
+        void SaveState(std::string &out) const override;
+
+        void LoadState(std::string_view &in) override;
+
     private:
         std::optional<int> current_max;
     };
@@ -52,36 +143,421 @@ namespace StatsAggregators {
     public:
         void Process(int value) override;
 
+        void ProcessBatch(const int *values, size_t count) override;
+
+        // То же, что ProcessBatch для блока с этой сводкой
+        void ProcessSummary(const BlockSummary &summary);
+
         void PrintValue(std::ostream &out) const override;
 
+        std::unique_ptr<StatsAggregator> Clone() const override;
+
+        void Merge(const StatsAggregator &other) override;
+
+        void SaveState(std::string &out) const override;
+
+        void LoadState(std::string_view &in) override;
+
     private:
         int sum = 0;
-        int total = 0;
+        // Число значений не ограничено размером int: длинный поток или
+        // Merge нескольких частей легко превышают 2^31
+        int64_t total = 0;
     };
 
     class Mode : public StatsAggregator {
     public:
         void Process(int value) override;
 
+        void ProcessBatch(const int *values, size_t size) override;
+
         void PrintValue(std::ostream &out) const override;
 
+        std::unique_ptr<StatsAggregator> Clone() const override;
+
+        void Merge(const StatsAggregator &other) override;
+
+        void SaveState(std::string &out) const override;
+
+        void LoadState(std::string_view &in) override;
+
+        // Пока все значения укладываются в диапазон из DENSE_LIMIT чисел,
+        // счётчики лежат в плотном массиве, а не в хеш-таблице
+        static const size_t DENSE_LIMIT = 1 << 16;
+
     private:
-        std::unordered_map<int, int> count;
+        // last_seen — номер последнего вхождения значения в поток. Среди
+        // значений с равной частотой модой остаётся то, которое первым набрало
+        // эту частоту, то есть с самым ранним последним вхождением; это
+        // позволяет слить частичные результаты так же, как при одном проходе.
+        struct Entry {
+            int count = 0;
+            uint64_t last_seen = 0;
+        };
+
+        Entry &At(int value);
+
+        // Расширяет плотный массив до value; если диапазон становится больше
+        // DENSE_LIMIT, переносит счётчики в хеш-таблицу и возвращает false
+        bool GrowDense(int value);
+
+        template<typename Func>
+        void ForEachEntry(Func func) const;
+
+        // Выбирает моду заново по счётчикам: наибольшая частота,
+        // а при равенстве — самое раннее последнее вхождение
+        void RecomputeMode();
+
+        // dense[i] — счётчик значения dense_base + i
+        std::vector<Entry> dense;
+        int64_t dense_base = 0;
+        bool sparse = false;
+        std::unordered_map<int, Entry> count;
+
         std::optional<int> mode;
+        int mode_count = 0;
+        uint64_t processed = 0;
+    };
+
+    // Приближённая мода по алгоритму Space-Saving: хранит не больше Capacity()
+    // счётчиков, их число определяется бюджетом памяти в байтах. Когда
+    // счётчики кончаются, новое значение занимает счётчик с наименьшей
+    // частотой и наследует её как ошибку. Если N — число обработанных
+    // значений, а k — Capacity(), то:
+    //   - каждый счётчик завышает частоту не больше чем на ErrorBound() <= N / k;
+    //   - значение, встретившееся больше N / k раз, обязательно отслеживается;
+    //   - частота выданной моды меньше частоты настоящей не больше чем на N / k;
+    //   - пока различных значений не больше k, результат совпадает с Mode.
+    // Merge сохраняет эти оценки для суммарного N.
+    class ApproximateMode : public StatsAggregator {
+    public:
+        static const size_t DEFAULT_MEMORY_BUDGET = 1 << 20;
+
+        explicit ApproximateMode(size_t memory_budget = DEFAULT_MEMORY_BUDGET);
+
+        void Process(int value) override;
+
+        void ProcessBatch(const int *values, size_t count) override;
+
+        void PrintValue(std::ostream &out) const override;
+
+        std::unique_ptr<StatsAggregator> Clone() const override;
+
+        void Merge(const StatsAggregator &other) override;
+
+        void SaveState(std::string &out) const override;
+
+        void LoadState(std::string_view &in) override;
+
+        size_t Capacity() const;
+
+        uint64_t ErrorBound() const;
+
+    private:
+        static const uint32_t NONE = UINT32_MAX;
+
+        // Счётчики с одинаковой частотой связаны в список своей корзины,
+        // а корзины — в список по возрастанию частоты (Stream-Summary),
+        // поэтому и увеличение, и вытеснение занимают O(1)
+        struct Counter {
+            int value = 0;
+            uint32_t bucket = NONE;
+            uint32_t prev = NONE;
+            uint32_t next = NONE;
+            uint64_t error = 0;
+            uint64_t last_seen = 0;
+        };
+
+        struct Bucket {
+            uint64_t count = 0;
+            uint32_t first = NONE;
+            uint32_t prev = NONE;
+            uint32_t next = NONE;
+        };
+
+        // Ячейка таблицы, где лежит value, или пустая ячейка, куда его вставлять
+        size_t FindSlot(int value) const;
+
+        void EraseSlot(int value);
+
+        uint64_t Count(uint32_t counter) const;
+
+        // Создаёт корзину сразу после prev (NONE — в начале списка)
+        uint32_t AddBucket(uint64_t count, uint32_t prev);
+
+        void Link(uint32_t counter, uint32_t bucket);
+
+        // Убирает счётчик из корзины, а опустевшую корзину — из списка
+        void Unlink(uint32_t counter);
+
+        void Increment(uint32_t counter);
+
+        // Заново строит сводку из счётчиков с их частотами, оставляя
+        // capacity самых частых; последнее вхождение решает ничьи при выборе моды
+        void Rebuild(std::vector<std::pair<uint64_t, Counter>> entries);
+
+        size_t capacity;
+        std::vector<Counter> counters;
+        std::vector<Bucket> buckets;
+        std::vector<uint32_t> free_buckets;
+        uint32_t min_bucket = NONE;
+        // Открытая адресация: индекс в counters плюс один, 0 — пустая ячейка
+        std::vector<uint32_t> slots;
+
+        std::optional<int> mode;
+        uint64_t mode_count = 0;
+        uint64_t processed = 0;
+    };
+
+    // Квантиль по KLL-скетчу (Karnin, Lang, Liberty). Значения копятся
+    // в уровнях-компакторах: переполненный уровень сортируется, и каждое
+    // второе значение уходит уровнем выше с удвоенным весом. Вместимость
+    // уровней убывает геометрически сверху вниз, так что скетч держит
+    // около 3k значений плюс по паре на каждый из log(N / k) уровней,
+    // а сортировки дают амортизированно O(log k) на значение, то есть
+    // константу при фиксированном k. Ошибка по рангу порядка 1 / k:
+    // при k = 200 обычно в пределах 1-2%. Пока сжатий не было, ответ
+    // точный — это значение с номером ceil(quantile * N) в порядке возрастания.
+    class Quantile : public StatsAggregator {
+    public:
+        static const size_t DEFAULT_K = 200;
+
+        explicit Quantile(double quantile, size_t k = DEFAULT_K);
+
+        void Process(int value) override;
+
+        void ProcessBatch(const int *values, size_t count) override;
+
+        void PrintValue(std::ostream &out) const override;
+
+        std::unique_ptr<StatsAggregator> Clone() const override;
+
+        // Сливаются только скетчи одного и того же квантиля
+        void Merge(const StatsAggregator &other) override;
+
+        void SaveState(std::string &out) const override;
+
+        void LoadState(std::string_view &in) override;
+
+    private:
+        size_t LevelCapacity(size_t level) const;
+
+        void AddLevel();
+
+        // Сжимает самый нижний переполненный уровень
+        void Compress();
+
+        double quantile;
+        size_t k;
+        // Значение на уровне h весит 2^h
+        std::vector<std::vector<int>> levels;
+        size_t size = 0;
+        size_t max_size = 0;
+        uint64_t random_state = 0x9E3779B97F4A7C15ull;
+    };
+
+    // Число различных значений по HyperLogLog с 2^precision однобайтовыми
+    // регистрами; относительная ошибка около 1.04 / sqrt(2^precision),
+    // то есть 0.8% при precision = 14. Пока различных значений не больше
+    // 2^precision / 16, хранятся их хеши и ответ точный: хеш взаимно
+    // однозначен на int, а памяти на это уходит не больше, чем на регистры.
+    class Distinct : public StatsAggregator {
+    public:
+        static const int MIN_PRECISION = 4;
+        static const int MAX_PRECISION = 18;
+        static const int DEFAULT_PRECISION = 14;
+
+        // precision вне [MIN_PRECISION, MAX_PRECISION] приводит к invalid_argument
+        explicit Distinct(int precision = DEFAULT_PRECISION);
+
+        void Process(int value) override;
+
+        void ProcessBatch(const int *values, size_t count) override;
+
+        void PrintValue(std::ostream &out) const override;
+
+        std::unique_ptr<StatsAggregator> Clone() const override;
+
+        // Сливаются только агрегаторы с одинаковой точностью
+        void Merge(const StatsAggregator &other) override;
+
+        void SaveState(std::string &out) const override;
+
+        void LoadState(std::string_view &in) override;
+
+        uint64_t Estimate() const;
+
+    private:
+        void AddHash(uint64_t hash);
+
+        void AddToRegisters(uint64_t hash);
+
+        void SwitchToRegisters();
+
+        int precision;
+        // Точный режим: открытая адресация по хешам, 0 — пустая ячейка
+        std::vector<uint64_t> exact;
+        size_t exact_count = 0;
+        std::vector<uint8_t> registers;
     };
 
     class Composite : public StatsAggregator {
     public:
+        Composite() = default;
+
+        Composite(const Composite &other);
+
+        Composite &operator=(const Composite &other);
+
+        Composite(Composite &&) = default;
+
+        Composite &operator=(Composite &&) = default;
+
         void Process(int value) override;
 
+        void ProcessBatch(const int *values, size_t count) override;
+
+        void ProcessAt(int64_t timestamp, int value) override;
+
         void PrintValue(std::ostream &output) const override;
 
         void Add(std::unique_ptr<StatsAggregator> aggr);
 
+        std::unique_ptr<StatsAggregator> Clone() const override;
+
+        void Merge(const StatsAggregator &other) override;
+
+        void SaveState(std::string &out) const override;
+
+        void LoadState(std::string_view &in) override;
+
     private:
         std::vector<std::unique_ptr<StatsAggregator>> aggregators;
     };
 
+    template<typename Aggregator, typename = void>
+    struct HasProcessSummary : std::false_type {
+    };
+
+    template<typename Aggregator>
+    struct HasProcessSummary<Aggregator, std::void_t<decltype(&Aggregator::ProcessSummary)>> : std::true_type {
+    };
+
+    // Композиция, набор агрегаторов которой известен при компиляции.
+    // Методы частей вызываются с явным указанием класса, то есть без
+    // виртуальной диспетчеризации. Для частей с ProcessSummary блок
+    // проходится один раз через SummarizeBlock, и сводка достаётся им всем:
+    // "sum min max avg" стоит одного векторного прохода вместо четырёх.
+    // Остальные части получают блок в свой ProcessBatch.
+    template<typename... Aggregators>
+    class StaticComposite final : public StatsAggregator {
+    public:
+        StaticComposite() {
+            for (size_t i = 0; i < print_order.size(); ++i) {
+                print_order[i] = i;
+            }
+        }
+
+        // print_order[k] — номер части, которая печатается k-й
+        explicit StaticComposite(const std::array<size_t, sizeof...(Aggregators)> &print_order)
+                : print_order(print_order) {
+        }
+
+        void Process(int value) override {
+            ProcessAll(value, std::index_sequence_for<Aggregators...>{});
+        }
+
+        void ProcessBatch(const int *values, size_t count) override {
+            if (count == 0) {
+                return;
+            }
+            BlockSummary summary;
+            if constexpr ((HasProcessSummary<Aggregators>::value || ...)) {
+                summary = SummarizeBlock(values, count);
+            }
+            ProcessBatchAll(values, count, summary, std::index_sequence_for<Aggregators...>{});
+        }
+
+        void PrintValue(std::ostream &output) const override {
+            for (size_t index : print_order) {
+                PrintPart(output, index, std::index_sequence_for<Aggregators...>{});
+                output << '\n';
+            }
+        }
+
+        std::unique_ptr<StatsAggregator> Clone() const override {
+            return std::make_unique<StaticComposite>(*this);
+        }
+
+        void Merge(const StatsAggregator &other) override {
+            const auto *same = dynamic_cast<const StaticComposite *>(&other);
+            if (same == nullptr) {
+                throw std::invalid_argument("StaticComposite::Merge: different aggregator set");
+            }
+            MergeAll(*same, std::index_sequence_for<Aggregators...>{});
+        }
+
+        // Состояния частей подряд; каждая часть проверяет свой тег сама
+        void SaveState(std::string &out) const override {
+            std::apply([&out](const auto &... parts) {
+                (parts.SaveState(out), ...);
+            }, parts);
+        }
+
+        void LoadState(std::string_view &in) override {
+            auto loaded = parts;
+            std::apply([&in](auto &... parts) {
+                (parts.LoadState(in), ...);
+            }, loaded);
+            parts = std::move(loaded);
+        }
+
+    private:
+        template<size_t... Is>
+        void MergeAll(const StaticComposite &other, std::index_sequence<Is...>) {
+            (std::get<Is>(parts).Aggregators::Merge(std::get<Is>(other.parts)), ...);
+        }
+
+        template<size_t... Is>
+        void ProcessAll(int value, std::index_sequence<Is...>) {
+            (std::get<Is>(parts).Aggregators::Process(value), ...);
+        }
+
+        template<size_t... Is>
+        void ProcessBatchAll(const int *values, size_t count, const BlockSummary &summary,
+                             std::index_sequence<Is...>) {
+            (ProcessBlock(std::get<Is>(parts), values, count, summary), ...);
+        }
+
+        template<typename Part>
+        static void ProcessBlock(Part &part, const int *values, size_t count, const BlockSummary &summary) {
+            if constexpr (HasProcessSummary<Part>::value) {
+                part.Part::ProcessSummary(summary);
+            } else {
+                part.Part::ProcessBatch(values, count);
+            }
+        }
+
+        template<size_t... Is>
+        void PrintPart(std::ostream &output, size_t index, std::index_sequence<Is...>) const {
+            ((Is == index ? std::get<Is>(parts).Aggregators::PrintValue(output) : void()), ...);
+        }
+
+        std::tuple<Aggregators...> parts;
+        std::array<size_t, sizeof...(Aggregators)> print_order;
+    };
+
+    // Заранее инстанцированы в stats_aggregator.cpp, где видны тела Process
+    extern template class StaticComposite<Sum, Min, Max, Average, Mode>;
+    extern template class StaticComposite<Sum, Min, Max, Average>;
+    extern template class StaticComposite<Min, Max>;
+    extern template class StaticComposite<Sum, Average>;
+
+    // Возвращает StaticComposite для заранее инстанцированного набора имён
+    // ("sum", "min", "max", "avg", "mode") в любом порядке, иначе nullptr.
+    // Части печатаются в порядке names.
+    std::unique_ptr<StatsAggregator> MakeStaticComposite(const std::vector<std::string> &names);
+
     void TestSum();
 
     void TestMin();
@@ -92,6 +568,22 @@ namespace StatsAggregators {
 
     void TestMode();
 
+    void TestModeDense();
+
+    void TestApproximateMode();
+
+    void TestQuantile();
+
+    void TestDistinct();
+
     void TestComposite();
 
+    void TestProcessBatch();
+
+    void TestStaticComposite();
+
+    void TestMerge();
+
+    void TestSaveState();
+
 }
\ No newline at end of file
@@ -1,6 +1,11 @@
 #include "stats_aggregator.h"
 #include "test_runner.h"
 
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <map>
+#include <random>
 #include <sstream>
 using namespace std;
 
@@ -10,6 +15,19 @@ string PrintedValue(const StatsAggregator& aggr) {
     return output.str();
 }
 
+// Мода по определению: значение, первым набравшее наибольшую частоту
+int ReferenceMode(const vector<int> &values) {
+    map<int, int> count;
+    int mode = values.front(), mode_count = 0;
+    for (int value : values) {
+        if (++count[value] > mode_count) {
+            mode = value;
+            mode_count = count[value];
+        }
+    }
+    return mode;
+}
+
 namespace StatsAggregators {
 
     void TestSum() {
@@ -58,6 +76,22 @@ namespace StatsAggregators {
         aggr.Process(16);
 
         ASSERT_EQUAL(PrintedValue(aggr), "Average is 6");
+
+        // 2^32 значений после слияний: счётчик не переполняется
+        Average large;
+        large.Process(0);
+        for (int i = 0; i < 32; ++i) {
+            const Average copy = large;
+            large.Merge(copy);
+        }
+        ASSERT_EQUAL(PrintedValue(large), "Average is 0");
+
+        string state;
+        large.SaveState(state);
+        Average loaded;
+        string_view in = state;
+        loaded.LoadState(in);
+        ASSERT_EQUAL(PrintedValue(loaded), "Average is 0");
     }
 
     void TestMode() {
@@ -78,6 +112,198 @@ namespace StatsAggregators {
         ASSERT_EQUAL(PrintedValue(aggr), "Mode is 8");
     }
 
+    void TestModeDense() {
+        mt19937 random(7);
+        vector<int> values;
+        // Сначала узкий диапазон, который растёт в обе стороны,
+        // затем далёкое значение переводит счётчики в хеш-таблицу
+        for (int i = 0; i < 2000; ++i) {
+            values.push_back(100 + int(random() % 50));
+        }
+        for (int i = 0; i < 2000; ++i) {
+            values.push_back(int(random() % 30000) - 20000);
+        }
+        values.push_back(INT_MAX);
+        for (int i = 0; i < 200; ++i) {
+            values.push_back(int(random() % 10) + INT_MIN);
+        }
+
+        for (size_t size : {1u, 10u, 2000u, 4000u, 4001u, unsigned(values.size())}) {
+            const vector<int> prefix(values.begin(), values.begin() + size);
+            Mode aggr;
+            aggr.ProcessBatch(prefix.data(), prefix.size());
+            ASSERT_EQUAL(PrintedValue(aggr), "Mode is " + to_string(ReferenceMode(prefix)));
+
+            // Части в разных представлениях сливаются в тот же результат
+            for (size_t split : {size_t(0), size / 3, size}) {
+                Mode first, second;
+                first.ProcessBatch(prefix.data(), split);
+                second.ProcessBatch(prefix.data() + split, size - split);
+                first.Merge(second);
+                ASSERT_EQUAL(PrintedValue(first), PrintedValue(aggr));
+            }
+        }
+    }
+
+    void TestApproximateMode() {
+        ApproximateMode empty;
+        ASSERT_EQUAL(PrintedValue(empty), "Approximate mode is undefined");
+
+        // Пока различных значений не больше Capacity(), ответ точный
+        const size_t budget = 4096;
+        const size_t capacity = ApproximateMode(budget).Capacity();
+        ASSERT(capacity >= 32);
+
+        mt19937 random(11);
+        vector<int> few;
+        for (int i = 0; i < 5000; ++i) {
+            few.push_back(int(random() % capacity) * 1000);
+        }
+        ApproximateMode exact(budget);
+        exact.ProcessBatch(few.data(), few.size());
+        ASSERT_EQUAL(PrintedValue(exact), "Approximate mode is " + to_string(ReferenceMode(few)));
+        ASSERT_EQUAL(exact.ErrorBound(), 0u);
+
+        for (size_t split : {size_t(0), few.size() / 3, few.size()}) {
+            ApproximateMode first(budget), second(budget);
+            first.ProcessBatch(few.data(), split);
+            second.ProcessBatch(few.data() + split, few.size() - split);
+            first.Merge(second);
+            ASSERT_EQUAL(PrintedValue(first), PrintedValue(exact));
+        }
+
+        // Частое значение среди множества редких находится при любом
+        // разбиении, а ошибка не превышает N / k
+        vector<int> many;
+        for (int i = 0; i < 100000; ++i) {
+            many.push_back(i % 8 == 0 ? -42 : int(random()));
+        }
+        ApproximateMode approximate(budget);
+        approximate.ProcessBatch(many.data(), many.size());
+        ASSERT_EQUAL(PrintedValue(approximate), "Approximate mode is -42");
+        ASSERT(approximate.ErrorBound() <= many.size() / capacity);
+
+        ApproximateMode merged(budget);
+        for (size_t begin = 0; begin < many.size(); begin += 30000) {
+            ApproximateMode part(budget);
+            part.ProcessBatch(many.data() + begin, min<size_t>(30000, many.size() - begin));
+            merged.Merge(part);
+        }
+        ASSERT_EQUAL(PrintedValue(merged), "Approximate mode is -42");
+        ASSERT(merged.ErrorBound() <= many.size() / capacity);
+
+        try {
+            merged.Merge(Mode());
+            Assert(false, "ApproximateMode::Merge() should throw std::invalid_argument for Mode");
+        } catch (invalid_argument &) {
+        }
+    }
+
+    void TestQuantile() {
+        Quantile empty(0.5);
+        ASSERT_EQUAL(PrintedValue(empty), "Percentile 50 is undefined");
+
+        // Пока скетч не сжимался, ответ точный
+        Quantile small(0.9);
+        for (int value : {7, 1, 9, 3, 5, 2, 8, 4, 6, 10}) {
+            small.Process(value);
+        }
+        ASSERT_EQUAL(PrintedValue(small), "Percentile 90 is 9");
+
+        // На длинном потоке ошибка по рангу остаётся в пределах нескольких
+        // процентов, в том числе после слияния частей
+        const int n = 1000000;
+        vector<int> values(n);
+        for (int i = 0; i < n; ++i) {
+            values[i] = i;
+        }
+        shuffle(values.begin(), values.end(), mt19937(3));
+
+        for (double q : {0.5, 0.9, 0.99}) {
+            Quantile whole(q);
+            whole.ProcessBatch(values.data(), values.size());
+
+            Quantile merged(q);
+            for (int begin = 0; begin < n; begin += n / 7) {
+                Quantile part(q);
+                part.ProcessBatch(values.data() + begin, min(n / 7, n - begin));
+                merged.Merge(*part.Clone());
+            }
+
+            for (const Quantile *sketch : {&whole, &merged}) {
+                const string printed = PrintedValue(*sketch);
+                const int value = stoi(printed.substr(printed.rfind(' ') + 1));
+                ASSERT(abs(value - q * n) < 0.02 * n);
+            }
+        }
+
+        Quantile median(0.5);
+        try {
+            median.Merge(Quantile(0.99));
+            Assert(false, "Quantile::Merge() should throw std::invalid_argument for another quantile");
+        } catch (invalid_argument &) {
+        }
+    }
+
+    void TestDistinct() {
+        Distinct empty;
+        ASSERT_EQUAL(PrintedValue(empty), "Distinct is 0");
+
+        // Точный режим, включая крайние значения int
+        Distinct small;
+        for (int value : {5, -5, 5, INT_MIN, INT_MAX, 0, 0, -1}) {
+            small.Process(value);
+        }
+        ASSERT_EQUAL(PrintedValue(small), "Distinct is 6");
+
+        Distinct exact_limit(Distinct::DEFAULT_PRECISION);
+        const int exact_count = (1 << Distinct::DEFAULT_PRECISION) / 16;
+        for (int i = 0; i < 3 * exact_count; ++i) {
+            exact_limit.Process(i % exact_count * 7919);
+        }
+        ASSERT_EQUAL(exact_limit.Estimate(), uint64_t(exact_count));
+
+        // Оценка в пределах нескольких стандартных ошибок, целиком и после слияния
+        for (int precision : {10, 14}) {
+            const int n = 300000;
+            vector<int> values(n);
+            mt19937 random(precision);
+            for (int i = 0; i < n; ++i) {
+                values[i] = i % 2 == 0 ? i : -i;
+            }
+            shuffle(values.begin(), values.end(), random);
+
+            Distinct whole(precision);
+            whole.ProcessBatch(values.data(), values.size());
+
+            Distinct merged(precision), exact_part(precision);
+            exact_part.Process(values[0]);
+            merged.Merge(exact_part);
+            for (int begin = 0; begin < n; begin += n / 3) {
+                Distinct part(precision);
+                part.ProcessBatch(values.data() + begin, n / 3);
+                merged.Merge(part);
+                // Повторное слияние того же не меняет оценку
+                merged.Merge(part);
+            }
+            ASSERT_EQUAL(merged.Estimate(), whole.Estimate());
+
+            const double error = 1.04 / sqrt(double(1 << precision));
+            ASSERT(abs(double(whole.Estimate()) - n) < 4 * error * n);
+        }
+
+        try {
+            Distinct(3);
+            Assert(false, "Distinct() should throw std::invalid_argument for precision 3");
+        } catch (invalid_argument &) {
+        }
+        try {
+            Distinct(10).Merge(Distinct(11));
+            Assert(false, "Distinct::Merge() should throw std::invalid_argument for another precision");
+        } catch (invalid_argument &) {
+        }
+    }
+
     void TestComposite() {
         Composite aggr;
         aggr.Add(make_unique<Sum>());
@@ -100,4 +326,237 @@ namespace StatsAggregators {
         ASSERT_EQUAL(PrintedValue(aggr), expected);
     }
 
-}
\ No newline at end of file
+
+    void TestProcessBatch() {
+        vector<int> values;
+        for (int i = 0; i < 1000; ++i) {
+            values.push_back((i * 7919) % 2003 - 1001);
+        }
+        values.push_back(numeric_limits<int>::max());
+        values.push_back(numeric_limits<int>::max());
+        values.push_back(numeric_limits<int>::min());
+
+        auto make_composite = [] {
+            auto aggr = make_unique<Composite>();
+            aggr->Add(make_unique<Sum>());
+            aggr->Add(make_unique<Min>());
+            aggr->Add(make_unique<Max>());
+            aggr->Add(make_unique<Average>());
+            aggr->Add(make_unique<Mode>());
+            return aggr;
+        };
+
+        for (size_t size : {0u, 1u, 3u, 4u, 7u, 8u, 9u, 17u, 1003u}) {
+            auto expected = make_composite();
+            for (size_t i = 0; i < size; ++i) {
+                expected->Process(values[i]);
+            }
+
+            auto batched = make_composite();
+            size_t half = size / 2;
+            batched->ProcessBatch(values.data(), half);
+            batched->ProcessBatch(values.data() + half, size - half);
+
+            ASSERT_EQUAL(PrintedValue(*batched), PrintedValue(*expected));
+        }
+    }
+
+    void TestStaticComposite() {
+        const vector<int> values = {3, 8, -1, 16, 16, 5, -7, 3, 3};
+
+        StaticComposite<Sum, Min, Max, Average, Mode> fused;
+        Composite dynamic;
+        dynamic.Add(make_unique<Sum>());
+        dynamic.Add(make_unique<Min>());
+        dynamic.Add(make_unique<Max>());
+        dynamic.Add(make_unique<Average>());
+        dynamic.Add(make_unique<Mode>());
+
+        fused.Process(values[0]);
+        fused.ProcessBatch(values.data() + 1, values.size() - 1);
+        dynamic.ProcessBatch(values.data(), values.size());
+        ASSERT_EQUAL(PrintedValue(fused), PrintedValue(dynamic));
+
+        auto min_max = MakeStaticComposite({"min", "max"});
+        ASSERT(min_max != nullptr);
+        min_max->ProcessBatch(values.data(), values.size());
+        ASSERT_EQUAL(PrintedValue(*min_max), "Min is -7\nMax is 16\n");
+
+        // Порядок имён не важен для выбора набора, но задаёт порядок вывода
+        auto max_min = MakeStaticComposite({"max", "min"});
+        ASSERT(max_min != nullptr);
+        max_min->ProcessBatch(values.data(), values.size());
+        ASSERT_EQUAL(PrintedValue(*max_min), "Max is 16\nMin is -7\n");
+
+        auto shuffled = MakeStaticComposite({"mode", "avg", "max", "sum", "min"});
+        ASSERT(shuffled != nullptr);
+        shuffled->ProcessBatch(values.data(), values.size());
+        Composite expected;
+        expected.Add(make_unique<Mode>());
+        expected.Add(make_unique<Average>());
+        expected.Add(make_unique<Max>());
+        expected.Add(make_unique<Sum>());
+        expected.Add(make_unique<Min>());
+        expected.ProcessBatch(values.data(), values.size());
+        ASSERT_EQUAL(PrintedValue(*shuffled), PrintedValue(expected));
+
+        // Сводка блока за один проход сходится с отдельными агрегаторами
+        // при любой длине хвоста после векторной части
+        mt19937 random(5);
+        uniform_int_distribution<int> distribution(INT_MIN, INT_MAX);
+        for (size_t count : {1u, 3u, 4u, 7u, 8u, 9u, 31u, 1000u}) {
+            vector<int> block(count);
+            for (int &value : block) {
+                value = distribution(random);
+            }
+            StaticComposite<Sum, Min, Max, Average> summarized;
+            Composite separate;
+            separate.Add(make_unique<Sum>());
+            separate.Add(make_unique<Min>());
+            separate.Add(make_unique<Max>());
+            separate.Add(make_unique<Average>());
+            for (size_t repeat = 0; repeat < 2; ++repeat) {
+                summarized.ProcessBatch(block.data(), block.size());
+                separate.ProcessBatch(block.data(), block.size());
+            }
+            summarized.ProcessBatch(block.data(), 0);
+            ASSERT_EQUAL(PrintedValue(summarized), PrintedValue(separate));
+
+            const BlockSummary summary = SummarizeBlock(block.data(), block.size());
+            ASSERT_EQUAL(summary.min, *min_element(block.begin(), block.end()));
+            ASSERT_EQUAL(summary.max, *max_element(block.begin(), block.end()));
+            ASSERT_EQUAL(summary.count, count);
+        }
+
+        ASSERT(MakeStaticComposite({"mode"}) == nullptr);
+        ASSERT(MakeStaticComposite({"min", "min"}) == nullptr);
+        ASSERT(MakeStaticComposite({"min", "max", "p50"}) == nullptr);
+    }
+
+    void TestMerge() {
+        const vector<int> values = {1, 2, 2, 1, 5, -3, 5, 7, 1, 2, 7, 7, -3, 0};
+
+        auto make_composite = [] {
+            Composite aggr;
+            aggr.Add(make_unique<Sum>());
+            aggr.Add(make_unique<Min>());
+            aggr.Add(make_unique<Max>());
+            aggr.Add(make_unique<Average>());
+            aggr.Add(make_unique<Mode>());
+            return aggr;
+        };
+
+        Composite expected = make_composite();
+        expected.ProcessBatch(values.data(), values.size());
+        StaticComposite<Sum, Min, Max, Average, Mode> expected_static;
+        expected_static.ProcessBatch(values.data(), values.size());
+
+        for (size_t first = 0; first <= values.size(); ++first) {
+            for (size_t second = first; second <= values.size(); ++second) {
+                Composite merged = make_composite();
+                unique_ptr<StatsAggregator> merged_static = StaticComposite<Sum, Min, Max, Average, Mode>().Clone();
+
+                for (auto [begin, end] : vector<pair<size_t, size_t>>{{0, first}, {first, second}, {second, values.size()}}) {
+                    Composite part = make_composite();
+                    part.ProcessBatch(values.data() + begin, end - begin);
+                    merged.Merge(*part.Clone());
+
+                    StaticComposite<Sum, Min, Max, Average, Mode> part_static;
+                    part_static.ProcessBatch(values.data() + begin, end - begin);
+                    merged_static->Merge(part_static);
+                }
+
+                ASSERT_EQUAL(PrintedValue(merged), PrintedValue(expected));
+                ASSERT_EQUAL(PrintedValue(*merged_static), PrintedValue(expected));
+            }
+        }
+
+        Sum sum;
+        try {
+            sum.Merge(Min());
+            Assert(false, "StatsAggregator::Merge() should throw std::invalid_argument for different types");
+        } catch (invalid_argument &) {
+        }
+    }
+
+    void TestSaveState() {
+        vector<int> values;
+        mt19937 random(11);
+        for (int i = 0; i < 20000; ++i) {
+            values.push_back(int(random() % 3000) - 1500);
+        }
+        values.push_back(INT_MAX);
+        values.push_back(INT_MIN);
+
+        auto make_composite = [] {
+            Composite aggr;
+            aggr.Add(make_unique<Sum>());
+            aggr.Add(make_unique<Min>());
+            aggr.Add(make_unique<Max>());
+            aggr.Add(make_unique<Average>());
+            aggr.Add(make_unique<Mode>());
+            aggr.Add(make_unique<ApproximateMode>(4096));
+            aggr.Add(make_unique<Quantile>(0.9));
+            aggr.Add(make_unique<Distinct>(8));
+            aggr.Add(make_unique<Distinct>());
+            return aggr;
+        };
+
+        // Восстановленный агрегатор должен не только печатать то же,
+        // но и дальше обрабатывать значения так же, как исходный
+        for (size_t split : {size_t(0), size_t(1), size_t(100), size_t(5000), values.size()}) {
+            Composite original = make_composite();
+            original.ProcessBatch(values.data(), split);
+            string state;
+            original.SaveState(state);
+
+            Composite restored = make_composite();
+            string_view in = state;
+            restored.LoadState(in);
+            ASSERT(in.empty());
+            ASSERT_EQUAL(PrintedValue(restored), PrintedValue(original));
+
+            original.ProcessBatch(values.data() + split, values.size() - split);
+            restored.ProcessBatch(values.data() + split, values.size() - split);
+            ASSERT_EQUAL(PrintedValue(restored), PrintedValue(original));
+        }
+
+        StaticComposite<Sum, Min, Max, Average, Mode> fused;
+        fused.ProcessBatch(values.data(), 777);
+        string fused_state;
+        fused.SaveState(fused_state);
+        auto fused_restored = MakeStaticComposite({"sum", "min", "max", "avg", "mode"});
+        string_view fused_in = fused_state;
+        fused_restored->LoadState(fused_in);
+        ASSERT_EQUAL(PrintedValue(*fused_restored), PrintedValue(fused));
+
+        // Чужое или оборванное состояние отвергается, а агрегатор остаётся прежним
+        Mode mode;
+        mode.ProcessBatch(values.data(), 10);
+        const string before = PrintedValue(mode);
+        string sum_state;
+        Sum().SaveState(sum_state);
+        string mode_state;
+        Mode other_mode;
+        other_mode.ProcessBatch(values.data() + 10, 100);
+        other_mode.SaveState(mode_state);
+        string quantile_state;
+        Quantile(0.5).SaveState(quantile_state);
+
+        for (string_view bad : {string_view(sum_state), string_view(mode_state).substr(0, mode_state.size() - 1),
+                                string_view()}) {
+            try {
+                mode.LoadState(bad);
+                Assert(false, "StatsAggregator::LoadState() should throw std::invalid_argument for a bad state");
+            } catch (invalid_argument &) {
+            }
+            ASSERT_EQUAL(PrintedValue(mode), before);
+        }
+        try {
+            string_view in = quantile_state;
+            Quantile(0.9).LoadState(in);
+            Assert(false, "Quantile::LoadState() should throw std::invalid_argument for another quantile");
+        } catch (invalid_argument &) {
+        }
+    }
+}
@@ -0,0 +1,334 @@
+#include "profile.h"
+
+#include "int_reader.h"
+#include "column_file.h"
+#include "mapped_file.h"
+#include "stats_aggregator.h"
+#include "stats_window.h"
+#include "stats_pipeline.h"
+
+#include <climits>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+using namespace StatsAggregators;
+
+// Собирайте с -DCMAKE_BUILD_TYPE=Release, иначе цифры не показательны.
+//
+// Параметры (все необязательны):
+//   --count N          число значений во входе, по умолчанию 20000000
+//   --window-values N  число значений для замеров окон, по умолчанию 10000000
+//   --seed N           зерно генератора, по умолчанию 42
+
+struct BenchmarkConfig {
+    size_t count = 20'000'000;
+    size_t window_values = 10'000'000;
+    uint64_t seed = 42;
+};
+
+BenchmarkConfig ParseArgs(int argc, char **argv) {
+    BenchmarkConfig config;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const string flag = argv[i];
+        const string value = argv[i + 1];
+        if (flag == "--count") {
+            config.count = stoul(value);
+        } else if (flag == "--window-values") {
+            config.window_values = max<size_t>(stoul(value), 1);
+        } else if (flag == "--seed") {
+            config.seed = stoull(value);
+        } else {
+            throw invalid_argument("unknown flag " + flag);
+        }
+    }
+    return config;
+}
+
+// Смесь коротких и длинных, положительных и отрицательных чисел
+string GenerateInput(const BenchmarkConfig &config) {
+    mt19937_64 random(config.seed);
+    uniform_int_distribution<int> small(-1000, 1000);
+    uniform_int_distribution<int> large(INT_MIN, INT_MAX);
+
+    string result;
+    result.reserve(config.count * 8);
+    for (size_t i = 0; i < config.count; ++i) {
+        result += to_string(random() % 2 ? small(random) : large(random));
+        result += i % 16 == 15 ? '\n' : ' ';
+    }
+    return result;
+}
+
+// Каждый способ чтения скармливает значения одному и тому же агрегатору,
+// так что сравнивается путь от байтов до ProcessBatch целиком
+double Measure(const string &name, size_t count, const function<void(StatsAggregator &)> &action) {
+    Sum sum;
+    TotalDuration total(name);
+    {
+        ADD_DURATION(total);
+        action(sum);
+    }
+    const double seconds = duration_cast<duration<double>>(total.value).count();
+    const double rate = count / max(seconds, 1e-9) / 1e6;
+    ostringstream value;
+    sum.PrintValue(value);
+    cerr << name << ": " << rate << " M values/s, " << value.str() << endl;
+    return rate;
+}
+
+void ReadWithStream(istream &input, StatsAggregator &aggr) {
+    vector<int> batch;
+    batch.reserve(4096);
+    for (int value; input >> value; ) {
+        batch.push_back(value);
+        if (batch.size() == 4096) {
+            aggr.ProcessBatch(batch.data(), batch.size());
+            batch.clear();
+        }
+    }
+    aggr.ProcessBatch(batch.data(), batch.size());
+}
+
+void ReadWithReader(IntReader &reader, StatsAggregator &aggr) {
+    vector<int> batch(4096);
+    while (size_t count = reader.ReadBatch(batch.data(), batch.size())) {
+        aggr.ProcessBatch(batch.data(), count);
+    }
+}
+
+// Время на значение не должно расти вместе с окном
+void MeasureWindows(const BenchmarkConfig &config) {
+    mt19937_64 random(config.seed);
+    uniform_int_distribution<int> distribution(-100000, 100000);
+    vector<int> values(config.window_values);
+    for (int &value : values) {
+        value = distribution(random);
+    }
+
+    using Builder = function<unique_ptr<StatsAggregator>(WindowSpan)>;
+    const vector<pair<string, Builder>> builders = {
+            {"sum", [](WindowSpan span) { return make_unique<WindowedSum>(span); }},
+            {"avg", [](WindowSpan span) { return make_unique<WindowedAverage>(span); }},
+            {"min", [](WindowSpan span) { return make_unique<WindowedMin>(span); }},
+            {"max", [](WindowSpan span) { return make_unique<WindowedMax>(span); }},
+            {"mode", [](WindowSpan span) { return make_unique<WindowedMode>(span); }},
+    };
+
+    for (const auto &[name, builder] : builders) {
+        for (int64_t length : {16, 1024, 65536, 1 << 20}) {
+            auto aggr = builder(WindowSpan::Values(length));
+            TotalDuration total(name + "@" + to_string(length));
+            {
+                ADD_DURATION(total);
+                aggr->ProcessBatch(values.data(), values.size());
+            }
+            const double nanoseconds = duration_cast<duration<double, nano>>(total.value).count();
+            cerr << name << "@" << length << ": " << nanoseconds / values.size() << " ns/value" << endl;
+        }
+    }
+}
+
+// "Сумма положительных" и "максимум утроенных": отдельный проход с буфером,
+// Pipeline со стадиями во время выполнения и FusedPipeline
+void MeasurePipelines(const BenchmarkConfig &config) {
+    mt19937_64 random(config.seed);
+    uniform_int_distribution<int> distribution(-100000, 100000);
+    vector<int> values(config.window_values);
+    for (int &value : values) {
+        value = distribution(random);
+    }
+
+    auto measure = [&values](const string &name, StatsAggregator &aggr, const function<void()> &action) {
+        TotalDuration total(name);
+        {
+            ADD_DURATION(total);
+            action();
+        }
+        const double nanoseconds = duration_cast<duration<double, nano>>(total.value).count();
+        ostringstream value;
+        aggr.PrintValue(value);
+        cerr << name << ": " << nanoseconds / values.size() << " ns/value, " << value.str() << endl;
+    };
+
+    auto positive = Filter([](int value) { return value > 0; });
+    auto triple = Map([](int value) { return value * 3; });
+
+    Sum separate_sum;
+    measure("sum of > 0, separate pass", separate_sum, [&] {
+        vector<int> passed;
+        passed.reserve(values.size());
+        for (int value : values) {
+            if (value > 0) {
+                passed.push_back(value);
+            }
+        }
+        separate_sum.ProcessBatch(passed.data(), passed.size());
+    });
+    Pipeline pipeline_sum(make_unique<Sum>());
+    pipeline_sum.AddStage(positive);
+    measure("sum of > 0, Pipeline", pipeline_sum, [&] {
+        pipeline_sum.ProcessBatch(values.data(), values.size());
+    });
+    auto fused_sum = MakeFusedPipeline(Sum(), positive);
+    measure("sum of > 0, FusedPipeline", fused_sum, [&] {
+        fused_sum.ProcessBatch(values.data(), values.size());
+    });
+
+    Max separate_max;
+    measure("max of *3, separate pass", separate_max, [&] {
+        vector<int> mapped(values.size());
+        for (size_t i = 0; i < values.size(); ++i) {
+            mapped[i] = values[i] * 3;
+        }
+        separate_max.ProcessBatch(mapped.data(), mapped.size());
+    });
+    Pipeline pipeline_max(make_unique<Max>());
+    pipeline_max.AddStage(triple);
+    measure("max of *3, Pipeline", pipeline_max, [&] {
+        pipeline_max.ProcessBatch(values.data(), values.size());
+    });
+    auto fused_max = MakeFusedPipeline(Max(), triple);
+    measure("max of *3, FusedPipeline", fused_max, [&] {
+        fused_max.ProcessBatch(values.data(), values.size());
+    });
+}
+
+// StaticComposite считает сводку блока для sum, min, max и avg за один
+// проход; сравнивается с виртуальным Composite, где каждая часть проходит
+// блок сама, и с поэлементным Process. Как и в main, блок из 4096 значений
+// только что разобран и лежит в кэше, поэтому он обрабатывается повторно,
+// а не читается из большого массива: иначе все три упираются в память.
+void MeasureComposites(const BenchmarkConfig &config) {
+    mt19937_64 random(config.seed);
+    uniform_int_distribution<int> distribution(-100000, 100000);
+    vector<int> values(4096);
+    for (int &value : values) {
+        value = distribution(random);
+    }
+    const size_t repeats = max<size_t>(config.window_values / values.size(), 1);
+
+    auto measure = [&values, repeats](const string &name, const function<void()> &action) {
+        TotalDuration total(name);
+        {
+            ADD_DURATION(total);
+            action();
+        }
+        const double nanoseconds = duration_cast<duration<double, nano>>(total.value).count();
+        cerr << name << ": " << nanoseconds / (values.size() * repeats) << " ns/value" << endl;
+    };
+    auto process_blocks = [&values, repeats](StatsAggregator &aggr) {
+        for (size_t i = 0; i < repeats; ++i) {
+            aggr.ProcessBatch(values.data(), values.size());
+        }
+    };
+
+    Composite dynamic;
+    dynamic.Add(make_unique<Sum>());
+    dynamic.Add(make_unique<Min>());
+    dynamic.Add(make_unique<Max>());
+    dynamic.Add(make_unique<Average>());
+    measure("sum min max avg, Composite", [&] { process_blocks(dynamic); });
+
+    StaticComposite<Sum, Min, Max, Average> per_value;
+    measure("sum min max avg, StaticComposite::Process", [&] {
+        for (size_t i = 0; i < repeats; ++i) {
+            for (int value : values) {
+                per_value.Process(value);
+            }
+        }
+    });
+
+    auto batched = MakeStaticComposite({"min", "sum", "max", "avg"});
+    measure("min sum max avg, StaticComposite::ProcessBatch", [&] { process_blocks(*batched); });
+}
+
+int main(int argc, char **argv) {
+    const BenchmarkConfig config = ParseArgs(argc, argv);
+
+    string text;
+    {
+        LOG_DURATION("Generate");
+        text = GenerateInput(config);
+    }
+    cerr << "Input size: " << text.size() / (1 << 20) << " MB, " << config.count << " values" << endl;
+
+    const string path = (filesystem::temp_directory_path() / "stats_benchmark.txt").string();
+    ofstream(path, ios::binary) << text;
+
+    // Так main читал вход раньше: cin, синхронизированный с stdio
+    const double baseline = Measure("cin >>", config.count, [&](StatsAggregator &aggr) {
+        if (freopen(path.c_str(), "rb", stdin) == nullptr) {
+            throw runtime_error("cannot reopen stdin");
+        }
+        ReadWithStream(cin, aggr);
+    });
+    Measure("ifstream >>", config.count, [&](StatsAggregator &aggr) {
+        ifstream input(path);
+        ReadWithStream(input, aggr);
+    });
+    Measure("istringstream >>", config.count, [&](StatsAggregator &aggr) {
+        istringstream input(text);
+        ReadWithStream(input, aggr);
+    });
+    const double from_file = Measure("IntReader(FILE *)", config.count, [&](StatsAggregator &aggr) {
+        FILE *input = fopen(path.c_str(), "rb");
+        IntReader reader(input);
+        ReadWithReader(reader, aggr);
+        fclose(input);
+    });
+    const double mapped = Measure("IntReader(MappedFile)", config.count, [&](StatsAggregator &aggr) {
+        MappedFile file(path);
+        IntReader reader(file.Data());
+        ReadWithReader(reader, aggr);
+    });
+
+    cerr << "Speedup over cin >>: FILE " << from_file / baseline << "x, mmap " << mapped / baseline << "x" << endl;
+
+    // Те же значения в колоночном формате: текст разбирать не нужно
+    vector<int64_t> values;
+    {
+        IntReader reader(text);
+        vector<int> batch(4096);
+        while (size_t count = reader.ReadBatch(batch.data(), batch.size())) {
+            values.insert(values.end(), batch.begin(), batch.begin() + count);
+        }
+    }
+    const vector<tuple<string, size_t, ColumnEncoding>> formats = {
+            {"plain int32", 4, ColumnEncoding::Plain},
+            {"plain int64", 8, ColumnEncoding::Plain},
+            {"varint", 4, ColumnEncoding::Varint},
+            {"delta", 4, ColumnEncoding::Delta},
+    };
+    for (const auto &[name, width, encoding] : formats) {
+        const string column_path = (filesystem::temp_directory_path() / "stats_benchmark.col").string();
+        const string encoded = EncodeColumn(values, width, encoding);
+        ofstream(column_path, ios::binary) << encoded;
+        cerr << "Column file, " << name << ": " << encoded.size() / (1 << 20) << " MB" << endl;
+        const double rate = Measure("ColumnReader, " + name, config.count, [&](StatsAggregator &aggr) {
+            MappedFile file(column_path);
+            ColumnReader reader(file.Data());
+            const int *block = nullptr;
+            while (size_t count = reader.NextBlock(block)) {
+                aggr.ProcessBatch(block, count);
+            }
+        });
+        cerr << "Speedup over cin >>: " << rate / baseline << "x, " << rate * 1e6 * width / (1 << 20)
+             << " MB/s of decoded values" << endl;
+        remove(column_path.c_str());
+    }
+
+    remove(path.c_str());
+
+    MeasureWindows(config);
+    MeasurePipelines(config);
+    MeasureComposites(config);
+    return 0;
+}
@@ -0,0 +1,145 @@
+#include "stats_checkpoint.h"
+#include "stats_state.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace StatsAggregators;
+
+namespace {
+    const char MAGIC[4] = {'S', 'C', 'K', 'P'};
+    const uint8_t VERSION = 1;
+
+    string ReadString(string_view &in) {
+        const uint64_t size = ReadUnsigned(in);
+        if (size > in.size()) {
+            throw invalid_argument("ReadCheckpoint: truncated checkpoint");
+        }
+        return string(ReadBytes(in, size));
+    }
+}
+
+void WriteCheckpoint(const string &path, const Checkpoint &checkpoint) {
+    string data(MAGIC, sizeof(MAGIC));
+    data.push_back(static_cast<char>(VERSION));
+    WriteUnsigned(data, checkpoint.spec.size());
+    data += checkpoint.spec;
+    WriteUnsigned(data, checkpoint.offset);
+    WriteUnsigned(data, checkpoint.state.size());
+    data += checkpoint.state;
+
+    // fsync до rename, чтобы переименование не опередило данные на диске,
+    // и fsync каталога после, чтобы пережило сбой само переименование
+    const string temp_path = path + ".tmp";
+    const int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw system_error(errno, generic_category(), "WriteCheckpoint: open " + temp_path);
+    }
+    for (size_t written = 0; written < data.size();) {
+        const ssize_t result = write(fd, data.data() + written, data.size() - written);
+        if (result < 0 && errno != EINTR) {
+            const int error = errno;
+            close(fd);
+            throw system_error(error, generic_category(), "WriteCheckpoint: write " + temp_path);
+        }
+        written += result > 0 ? static_cast<size_t>(result) : 0;
+    }
+    if (fsync(fd) < 0) {
+        const int error = errno;
+        close(fd);
+        throw system_error(error, generic_category(), "WriteCheckpoint: fsync " + temp_path);
+    }
+    close(fd);
+
+    if (rename(temp_path.c_str(), path.c_str()) != 0) {
+        throw system_error(errno, generic_category(), "WriteCheckpoint: rename " + temp_path + " to " + path);
+    }
+
+    string directory = filesystem::path(path).parent_path().string();
+    if (directory.empty()) {
+        directory = ".";
+    }
+    const int directory_fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (directory_fd < 0) {
+        throw system_error(errno, generic_category(), "WriteCheckpoint: open " + directory);
+    }
+    const int synced = fsync(directory_fd);
+    const int error = errno;
+    close(directory_fd);
+    if (synced < 0) {
+        throw system_error(error, generic_category(), "WriteCheckpoint: fsync " + directory);
+    }
+}
+
+optional<Checkpoint> ReadCheckpoint(const string &path) {
+    ifstream input(path, ios::binary);
+    if (!input) {
+        return nullopt;
+    }
+    const string data{istreambuf_iterator<char>(input), istreambuf_iterator<char>()};
+
+    string_view in = data;
+    if (in.size() < sizeof(MAGIC) + 1 || in.substr(0, sizeof(MAGIC)) != string_view(MAGIC, sizeof(MAGIC))) {
+        throw invalid_argument("ReadCheckpoint: not a checkpoint file");
+    }
+    if (static_cast<uint8_t>(in[sizeof(MAGIC)]) != VERSION) {
+        throw invalid_argument("ReadCheckpoint: unsupported version");
+    }
+    in.remove_prefix(sizeof(MAGIC) + 1);
+
+    Checkpoint result;
+    result.spec = ReadString(in);
+    result.offset = ReadUnsigned(in);
+    result.state = ReadString(in);
+    if (!in.empty()) {
+        throw invalid_argument("ReadCheckpoint: trailing data");
+    }
+    return result;
+}
+
+Checkpointer::Checkpointer(string path, string spec) : path(move(path)), spec(move(spec)) {
+}
+
+Checkpointer::~Checkpointer() {
+    if (pending.valid()) {
+        pending.wait();
+    }
+}
+
+bool Checkpointer::Save(const StatsAggregator &aggregator, uint64_t offset) {
+    if (pending.valid()) {
+        if (pending.wait_for(chrono::seconds(0)) != future_status::ready) {
+            return false;
+        }
+        spare = pending.get();
+    }
+
+    // На границе блока снимается только копия агрегатора; сериализация
+    // и запись идут в фоновом потоке, который работает со своей копией
+    // и своим буфером
+    pending = async(launch::async, [this, snapshot = aggregator.Clone(), offset, buffer = move(spare)]() mutable {
+        buffer.clear();
+        snapshot->SaveState(buffer);
+        Checkpoint checkpoint{spec, offset, move(buffer)};
+        WriteCheckpoint(path, checkpoint);
+        return move(checkpoint.state);
+    });
+    return true;
+}
+
+void Checkpointer::Wait() {
+    if (pending.valid()) {
+        spare = pending.get();
+    }
+}
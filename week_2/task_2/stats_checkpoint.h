@@ -0,0 +1,64 @@
+#pragma once
+
+#include "stats_aggregator.h"
+
+#include <cstdint>
+#include <future>
+#include <optional>
+#include <string>
+
+// Контрольная точка обработки: состояние агрегатора и позиция во входе,
+// с которой продолжать. Формат файла:
+//   char[4]  "SCKP"
+//   uint8    версия, 1
+//   LEB128   длина описания агрегаторов, затем само описание
+//   LEB128   позиция во входе в байтах
+//   LEB128   длина состояния, затем результат SaveState
+struct Checkpoint {
+    // По описанию проверяется, что точка снята с того же набора агрегаторов
+    std::string spec;
+    uint64_t offset = 0;
+    std::string state;
+};
+
+// Пишет во временный файл рядом с path и переименовывает его поверх path,
+// так что на диске всегда лежит целая точка, старая или новая, в том числе
+// после сбоя питания: файл и каталог сбрасываются на диск через fsync.
+// Ошибки ввода-вывода приводят к runtime_error.
+void WriteCheckpoint(const std::string &path, const Checkpoint &checkpoint);
+
+// nullopt, если файла нет; повреждённый файл приводит к invalid_argument
+std::optional<Checkpoint> ReadCheckpoint(const std::string &path);
+
+// Снимает контрольные точки, почти не останавливая обработку. Save только
+// копирует агрегатор через Clone; сериализация копии и запись на диск идут
+// в фоновом потоке, пока агрегатор обрабатывает следующие блоки. Буфер
+// сериализации один и переходит от записи к записи, так что его память
+// переиспользуется. Одновременно пишется не больше одной точки.
+class Checkpointer {
+public:
+    Checkpointer(std::string path, std::string spec);
+
+    Checkpointer(const Checkpointer &) = delete;
+
+    Checkpointer &operator=(const Checkpointer &) = delete;
+
+    // Дожидается незаконченной записи
+    ~Checkpointer();
+
+    // Если предыдущая точка ещё пишется, ничего не делает и возвращает false
+    bool Save(const StatsAggregator &aggregator, uint64_t offset);
+
+    // Дожидается записи; её ошибки пробрасываются отсюда или из следующего Save
+    void Wait();
+
+private:
+    std::string path;
+    std::string spec;
+    // Буфер сериализации, пока точка не пишется
+    std::string spare;
+    // Возвращает буфер, когда запись закончена
+    std::future<std::string> pending;
+};
+
+void TestCheckpoint();
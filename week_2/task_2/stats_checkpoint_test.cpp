@@ -0,0 +1,55 @@
+#include "stats_checkpoint.h"
+#include "test_runner.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+using namespace StatsAggregators;
+
+void TestCheckpoint() {
+    const string path = (filesystem::temp_directory_path() / "stats_checkpoint_test.bin").string();
+    remove(path.c_str());
+    ASSERT(!ReadCheckpoint(path).has_value());
+
+    WriteCheckpoint(path, {"sum mode", 12345, string("\x01\x00\xff", 3)});
+    auto checkpoint = ReadCheckpoint(path);
+    ASSERT(checkpoint.has_value());
+    ASSERT_EQUAL(checkpoint->spec, "sum mode");
+    ASSERT_EQUAL(checkpoint->offset, 12345u);
+    ASSERT_EQUAL(checkpoint->state, string("\x01\x00\xff", 3));
+
+    // Фоновая запись снимает копию: изменения после Save в точку не попадают
+    Composite aggr;
+    aggr.Add(make_unique<Sum>());
+    aggr.Add(make_unique<Mode>());
+    const vector<int> values = {4, 1, 4, 2, 1, 1};
+    aggr.ProcessBatch(values.data(), 3);
+    {
+        Checkpointer checkpointer(path, "sum mode");
+        ASSERT(checkpointer.Save(aggr, 6));
+        aggr.ProcessBatch(values.data() + 3, 3);
+        checkpointer.Wait();
+    }
+
+    checkpoint = ReadCheckpoint(path);
+    ASSERT_EQUAL(checkpoint->offset, 6u);
+    Composite restored;
+    restored.Add(make_unique<Sum>());
+    restored.Add(make_unique<Mode>());
+    string_view state = checkpoint->state;
+    restored.LoadState(state);
+    ostringstream printed;
+    restored.PrintValue(printed);
+    ASSERT_EQUAL(printed.str(), "Sum is 9\nMode is 4\n");
+
+    ofstream(path, ios::binary) << "SCKP\x01\x05" << "sum";
+    try {
+        ReadCheckpoint(path);
+        Assert(false, "ReadCheckpoint() should throw std::invalid_argument for a truncated file");
+    } catch (invalid_argument &) {
+    }
+    remove(path.c_str());
+}
@@ -0,0 +1,169 @@
+#include "stats_group.h"
+#include "int_reader.h"
+
+#include <cstring>
+#include <functional>
+
+using namespace std;
+
+namespace StatsAggregators {
+
+    namespace {
+        const size_t INITIAL_CAPACITY = 16;
+        const size_t BATCH_SIZE = 256;
+
+        bool IsSpace(char c) {
+            return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+        }
+
+        uint32_t Hash(string_view key) {
+            const size_t hash = std::hash<string_view>{}(key);
+            return static_cast<uint32_t>(hash ^ (hash >> 32));
+        }
+    }
+
+    void GroupedStats::AddColumn(unique_ptr<GroupColumn> column) {
+        for (size_t group = 0; group < key_begins.size(); ++group) {
+            column->AddGroup();
+        }
+        columns.push_back(move(column));
+    }
+
+    string_view GroupedStats::KeyAt(uint64_t key_begin) const {
+        uint32_t size;
+        memcpy(&size, key_bytes.data() + key_begin, sizeof(size));
+        return {key_bytes.data() + key_begin + sizeof(size), size};
+    }
+
+    // Таблица расширяется, когда заполнена наполовину; хеши лежат
+    // в ячейках, так что ключи при этом не перечитываются
+    void GroupedStats::Grow() {
+        vector<Slot> old = move(slots);
+        slots.assign(old.empty() ? INITIAL_CAPACITY : old.size() * 2, Slot{});
+        const size_t mask = slots.size() - 1;
+        for (const Slot &slot : old) {
+            if (slot.group != 0) {
+                size_t i = slot.hash & mask;
+                while (slots[i].group != 0) {
+                    i = (i + 1) & mask;
+                }
+                slots[i] = slot;
+            }
+        }
+    }
+
+    uint32_t GroupedStats::FindOrAddGroup(string_view key, uint32_t hash) {
+        if ((key_begins.size() + 1) * 2 > slots.size()) {
+            Grow();
+        }
+
+        const size_t mask = slots.size() - 1;
+        size_t i = hash & mask;
+        for (; slots[i].group != 0; i = (i + 1) & mask) {
+            if (slots[i].hash == hash && KeyAt(slots[i].key_begin) == key) {
+                return slots[i].group - 1;
+            }
+        }
+
+        const auto group = static_cast<uint32_t>(key_begins.size());
+        const auto size = static_cast<uint32_t>(key.size());
+        key_begins.push_back(key_bytes.size());
+        key_bytes.insert(key_bytes.end(), reinterpret_cast<const char *>(&size),
+                         reinterpret_cast<const char *>(&size) + sizeof(size));
+        key_bytes.insert(key_bytes.end(), key.begin(), key.end());
+        slots[i] = {group + 1, hash, key_begins.back()};
+        for (auto &column : columns) {
+            column->AddGroup();
+        }
+        return group;
+    }
+
+    void GroupedStats::Process(string_view key, int value) {
+        const uint32_t group = FindOrAddGroup(key, Hash(key));
+        for (auto &column : columns) {
+            column->Process(group, value);
+        }
+    }
+
+    void GroupedStats::ProcessBatch(const string_view *keys, const int *values, size_t count) {
+        batch_hashes.resize(count);
+        batch_groups.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            batch_hashes[i] = Hash(keys[i]);
+            if (!slots.empty()) {
+                __builtin_prefetch(&slots[batch_hashes[i] & (slots.size() - 1)]);
+            }
+        }
+        // Пока ячейки подгружаются, ничего не ждём; затем так же заранее
+        // запрашиваем ключи из первых ячеек, где совпал хеш
+        if (!slots.empty()) {
+            const size_t mask = slots.size() - 1;
+            for (size_t i = 0; i < count; ++i) {
+                const Slot &slot = slots[batch_hashes[i] & mask];
+                if (slot.group != 0 && slot.hash == batch_hashes[i]) {
+                    __builtin_prefetch(key_bytes.data() + slot.key_begin);
+                }
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            batch_groups[i] = FindOrAddGroup(keys[i], batch_hashes[i]);
+        }
+        for (auto &column : columns) {
+            column->ProcessBatch(batch_groups.data(), values, count);
+        }
+    }
+
+    bool GroupedStats::ProcessText(string_view text) {
+        const char *p = text.data();
+        const char *end = p + text.size();
+        string_view keys[BATCH_SIZE];
+        int values[BATCH_SIZE];
+        while (true) {
+            size_t count = 0;
+            bool finished = false;
+            while (count < BATCH_SIZE) {
+                while (p != end && IsSpace(*p)) {
+                    ++p;
+                }
+                if (p == end) {
+                    finished = true;
+                    break;
+                }
+                const char *key_begin = p;
+                while (p != end && !IsSpace(*p)) {
+                    ++p;
+                }
+                keys[count] = string_view(key_begin, p - key_begin);
+
+                while (p != end && IsSpace(*p)) {
+                    ++p;
+                }
+                p = ParseInt(p, end, values[count]);
+                if (p == nullptr) {
+                    ProcessBatch(keys, values, count);
+                    return false;
+                }
+                ++count;
+            }
+            ProcessBatch(keys, values, count);
+            if (finished) {
+                return true;
+            }
+        }
+    }
+
+    void GroupedStats::PrintValue(ostream &out) const {
+        for (uint32_t group = 0; group < key_begins.size(); ++group) {
+            for (const auto &column : columns) {
+                out << KeyAt(key_begins[group]) << ": ";
+                column->PrintValue(group, out);
+                out << '\n';
+            }
+        }
+    }
+
+    size_t GroupedStats::GroupCount() const {
+        return key_begins.size();
+    }
+
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "stats_aggregator.h"
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace StatsAggregators {
+
+    // Состояния одного агрегатора для всех групп. Группы нумеруются
+    // подряд с нуля в порядке появления.
+    class GroupColumn {
+    public:
+        virtual ~GroupColumn() = default;
+
+        // Добавляет группу с начальным состоянием
+        virtual void AddGroup() = 0;
+
+        virtual void Process(uint32_t group, int value) = 0;
+
+        // values[i] относится к группе groups[i]
+        virtual void ProcessBatch(const uint32_t *groups, const int *values, size_t count) = 0;
+
+        virtual void PrintValue(uint32_t group, std::ostream &out) const = 0;
+    };
+
+    // Состояния лежат подряд в одном векторе, а не в отдельных
+    // unique_ptr, и Process вызывается без виртуальной диспетчеризации.
+    // Новая группа получает копию prototype, так что параметры вроде
+    // квантиля или окна задаются один раз.
+    template<typename Aggregator>
+    class TypedGroupColumn final : public GroupColumn {
+    public:
+        explicit TypedGroupColumn(Aggregator prototype = Aggregator()) : prototype(std::move(prototype)) {
+        }
+
+        void AddGroup() override {
+            states.push_back(prototype);
+        }
+
+        void Process(uint32_t group, int value) override {
+            states[group].Aggregator::Process(value);
+        }
+
+        // При миллионах групп почти каждое состояние — промах кеша,
+        // поэтому состояния для следующих значений запрашиваются заранее
+        void ProcessBatch(const uint32_t *groups, const int *values, size_t count) override {
+            const size_t PREFETCH_DISTANCE = 8;
+            for (size_t i = 0; i < count; ++i) {
+                if (i + PREFETCH_DISTANCE < count) {
+                    __builtin_prefetch(&states[groups[i + PREFETCH_DISTANCE]]);
+                }
+                states[groups[i]].Aggregator::Process(values[i]);
+            }
+        }
+
+        void PrintValue(uint32_t group, std::ostream &out) const override {
+            states[group].Aggregator::PrintValue(out);
+        }
+
+    private:
+        Aggregator prototype;
+        std::vector<Aggregator> states;
+    };
+
+    // GROUP BY по строковому ключу: для каждого ключа свой набор состояний
+    // из колонок. Ключи хранятся друг за другом в одном буфере, а группа
+    // ищется в таблице с открытой адресацией, где рядом с номером группы
+    // лежат хеш и положение ключа, поэтому сравнение строк почти всегда
+    // одно и не требует лишних обращений к памяти.
+    class GroupedStats {
+    public:
+        void AddColumn(std::unique_ptr<GroupColumn> column);
+
+        void Process(std::string_view key, int value);
+
+        // То же, что Process для каждой пары, но группы всего блока ищутся
+        // заранее, а ячейки таблицы и состояния запрашиваются с упреждением
+        void ProcessBatch(const std::string_view *keys, const int *values, size_t count);
+
+        // Разбирает пары "ключ значение", разделённые пробельными символами.
+        // Как и IntReader, останавливается на значении, которое не является
+        // числом int, и в этом случае возвращает false.
+        bool ProcessText(std::string_view text);
+
+        // Для каждой группы в порядке появления печатает строки вида
+        // "ключ: <вывод агрегатора>"
+        void PrintValue(std::ostream &out) const;
+
+        size_t GroupCount() const;
+
+    private:
+        struct Slot {
+            uint32_t group = 0;  // номер группы плюс один, 0 — пустая ячейка
+            uint32_t hash = 0;
+            uint64_t key_begin = 0;
+        };
+
+        uint32_t FindOrAddGroup(std::string_view key, uint32_t hash);
+
+        // Ключ в key_bytes хранится как 4 байта длины и сами символы
+        std::string_view KeyAt(uint64_t key_begin) const;
+
+        void Grow();
+
+        std::vector<std::unique_ptr<GroupColumn>> columns;
+        std::vector<Slot> slots;
+        std::vector<char> key_bytes;
+        // key_begins[g] — начало ключа группы g в key_bytes
+        std::vector<uint64_t> key_begins;
+
+        std::vector<uint32_t> batch_hashes;
+        std::vector<uint32_t> batch_groups;
+    };
+
+    void TestGroupedStats();
+
+}
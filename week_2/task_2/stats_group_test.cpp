@@ -0,0 +1,77 @@
+#include "stats_group.h"
+#include "stats_window.h"
+#include "test_runner.h"
+
+#include <map>
+#include <random>
+#include <sstream>
+
+using namespace std;
+
+namespace StatsAggregators {
+
+    void TestGroupedStats() {
+        GroupedStats empty;
+        empty.AddColumn(make_unique<TypedGroupColumn<Sum>>());
+        ostringstream empty_output;
+        empty.PrintValue(empty_output);
+        ASSERT_EQUAL(empty_output.str(), "");
+
+        GroupedStats grouped;
+        grouped.AddColumn(make_unique<TypedGroupColumn<Sum>>());
+        grouped.AddColumn(make_unique<TypedGroupColumn<Max>>());
+        ASSERT(grouped.ProcessText("a 1\nb -5\n  a 7 c 0\tb 2 "));
+        // Колонка, добавленная позже, получает состояния для уже известных групп
+        grouped.AddColumn(make_unique<TypedGroupColumn<WindowedSum>>(WindowedSum(WindowSpan::Values(1))));
+        grouped.Process("a", 10);
+        ASSERT_EQUAL(grouped.GroupCount(), 3u);
+
+        ostringstream output;
+        grouped.PrintValue(output);
+        ASSERT_EQUAL(output.str(),
+                     "a: Sum is 18\n"
+                     "a: Max is 10\n"
+                     "a: Sum over last 1 values is 10\n"
+                     "b: Sum is -3\n"
+                     "b: Max is 2\n"
+                     "b: Sum over last 1 values is 0\n"
+                     "c: Sum is 0\n"
+                     "c: Max is 0\n"
+                     "c: Sum over last 1 values is 0\n");
+
+        // Разбор останавливается там же, где остановился бы cin >> key >> value
+        GroupedStats stopped;
+        stopped.AddColumn(make_unique<TypedGroupColumn<Sum>>());
+        ASSERT(!stopped.ProcessText("x 1 y two x 5"));
+        ASSERT(!stopped.ProcessText("x 1 y"));
+        ASSERT_EQUAL(stopped.GroupCount(), 1u);
+
+        // Много групп: таблица растёт, а результат совпадает с отдельными агрегаторами
+        mt19937 random(17);
+        GroupedStats many;
+        many.AddColumn(make_unique<TypedGroupColumn<Mode>>());
+        map<string, Mode> expected;
+        vector<string> order;
+        for (int i = 0; i < 200000; ++i) {
+            const string key = "key" + to_string(random() % 50000);
+            const int value = int(random() % 5);
+            many.Process(key, value);
+            auto [it, inserted] = expected.try_emplace(key);
+            if (inserted) {
+                order.push_back(key);
+            }
+            it->second.Process(value);
+        }
+        ASSERT_EQUAL(many.GroupCount(), expected.size());
+
+        ostringstream many_output, expected_output;
+        many.PrintValue(many_output);
+        for (const string &key : order) {
+            expected_output << key << ": ";
+            expected.at(key).PrintValue(expected_output);
+            expected_output << '\n';
+        }
+        ASSERT(many_output.str() == expected_output.str());
+    }
+
+}
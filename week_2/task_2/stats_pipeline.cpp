@@ -0,0 +1,101 @@
+#include "stats_pipeline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+
+namespace StatsAggregators {
+
+    namespace {
+        const size_t PASSED_BLOCK_SIZE = 1024;
+    }
+
+    // Порог делит выход генератора [1, 2^64) в пропорции rate
+    Sample::Sample(double rate, uint64_t seed) : state(seed == 0 ? 1 : seed) {
+        if (!(rate >= 0 && rate <= 1)) {
+            throw invalid_argument("Sample: rate out of [0, 1]");
+        }
+        threshold = rate == 1 ? UINT64_MAX : static_cast<uint64_t>(ldexp(rate, 64));
+    }
+
+    Pipeline::Pipeline(unique_ptr<StatsAggregator> aggregator) : aggregator(move(aggregator)) {
+    }
+
+    Pipeline::Pipeline(const Pipeline &other) : stages(other.stages), aggregator(other.aggregator->Clone()) {
+    }
+
+    Pipeline &Pipeline::operator=(const Pipeline &other) {
+        if (this != &other) {
+            Pipeline copy(other);
+            *this = move(copy);
+        }
+        return *this;
+    }
+
+    void Pipeline::AddStage(Stage stage) {
+        stages.push_back(move(stage));
+    }
+
+    bool Pipeline::Pass(int &value) {
+        for (auto &stage : stages) {
+            if (!stage(value)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void Pipeline::Process(int value) {
+        if (Pass(value)) {
+            aggregator->Process(value);
+        }
+    }
+
+    void Pipeline::ProcessBatch(const int *values, size_t count) {
+        int passed[PASSED_BLOCK_SIZE];
+        for (size_t begin = 0; begin < count; begin += PASSED_BLOCK_SIZE) {
+            const size_t end = min(count, begin + PASSED_BLOCK_SIZE);
+            size_t passed_count = 0;
+            for (size_t i = begin; i < end; ++i) {
+                int value = values[i];
+                if (Pass(value)) {
+                    passed[passed_count++] = value;
+                }
+            }
+            aggregator->ProcessBatch(passed, passed_count);
+        }
+    }
+
+    void Pipeline::ProcessAt(int64_t timestamp, int value) {
+        if (Pass(value)) {
+            aggregator->ProcessAt(timestamp, value);
+        }
+    }
+
+    void Pipeline::PrintValue(ostream &out) const {
+        aggregator->PrintValue(out);
+    }
+
+    unique_ptr<StatsAggregator> Pipeline::Clone() const {
+        return make_unique<Pipeline>(*this);
+    }
+
+    void Pipeline::Merge(const StatsAggregator &other) {
+        const auto *same = dynamic_cast<const Pipeline *>(&other);
+        if (same == nullptr) {
+            throw invalid_argument("StatsAggregator::Merge: aggregators of different types");
+        }
+        aggregator->Merge(*same->aggregator);
+    }
+
+    void Pipeline::SaveState(string &out) const {
+        aggregator->SaveState(out);
+    }
+
+    void Pipeline::LoadState(string_view &in) {
+        aggregator->LoadState(in);
+    }
+
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "stats_aggregator.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace StatsAggregators {
+
+    // Стадия получает значение по ссылке и возвращает false, чтобы
+    // его отбросить; изменённое значение уходит дальше по конвейеру.
+    // Стадии ниже годятся и для Pipeline, и для FusedPipeline.
+
+    // Пропускает значения, для которых predicate(value) истинно
+    template<typename Predicate>
+    class Filter {
+    public:
+        explicit Filter(Predicate predicate) : predicate(std::move(predicate)) {
+        }
+
+        bool operator()(int &value) const {
+            return predicate(value);
+        }
+
+    private:
+        Predicate predicate;
+    };
+
+    // Заменяет значение на func(value)
+    template<typename Func>
+    class Map {
+    public:
+        explicit Map(Func func) : func(std::move(func)) {
+        }
+
+        bool operator()(int &value) const {
+            value = func(value);
+            return true;
+        }
+
+    private:
+        Func func;
+    };
+
+    // Пропускает каждое значение с вероятностью rate. Генератор xorshift
+    // задаётся seed, так что выборка воспроизводима от запуска к запуску.
+    class Sample {
+    public:
+        explicit Sample(double rate, uint64_t seed = 0x9E3779B97F4A7C15ull);
+
+        // xorshift не выдаёт 0, поэтому rate = 0 не пропускает ничего
+        bool operator()(int &) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state <= threshold;
+        }
+
+    private:
+        uint64_t threshold;
+        uint64_t state;
+    };
+
+    using Stage = std::function<bool(int &value)>;
+
+    // Стадии, собранные во время выполнения, перед любым агрегатором.
+    // Прошедшие стадии значения копятся в небольшом буфере на стеке
+    // и уходят в агрегатор блоком, так что его ProcessBatch сохраняет
+    // свои векторные ядра. Merge, SaveState и LoadState касаются только
+    // агрегатора: стадии — это настройка, и у сливаемых конвейеров
+    // они должны совпадать. Состояние генератора Sample не сохраняется,
+    // поэтому main не сочетает --sample с --checkpoint.
+    class Pipeline : public StatsAggregator {
+    public:
+        explicit Pipeline(std::unique_ptr<StatsAggregator> aggregator);
+
+        Pipeline(const Pipeline &other);
+
+        Pipeline &operator=(const Pipeline &other);
+
+        Pipeline(Pipeline &&) = default;
+
+        Pipeline &operator=(Pipeline &&) = default;
+
+        // Стадии применяются в порядке добавления
+        void AddStage(Stage stage);
+
+        void Process(int value) override;
+
+        void ProcessBatch(const int *values, size_t count) override;
+
+        void ProcessAt(int64_t timestamp, int value) override;
+
+        void PrintValue(std::ostream &out) const override;
+
+        std::unique_ptr<StatsAggregator> Clone() const override;
+
+        void Merge(const StatsAggregator &other) override;
+
+        void SaveState(std::string &out) const override;
+
+        void LoadState(std::string_view &in) override;
+
+    private:
+        bool Pass(int &value);
+
+        std::vector<Stage> stages;
+        std::unique_ptr<StatsAggregator> aggregator;
+    };
+
+    // Конвейер, стадии и агрегатор которого известны при компиляции.
+    // Стадии встраиваются в цикл по блоку, а Process агрегатора вызывается
+    // с явным указанием класса, как в StaticComposite: значение проходит
+    // все стадии и попадает в агрегатор за одну итерацию, без отдельного
+    // прохода и промежуточного буфера. Остальное — как у Pipeline.
+    template<typename Aggregator, typename... Stages>
+    class FusedPipeline final : public StatsAggregator {
+    public:
+        explicit FusedPipeline(Aggregator aggregator, Stages... stages)
+                : aggregator(std::move(aggregator)), stages(std::move(stages)...) {
+        }
+
+        void Process(int value) override {
+            if (Pass(value, std::index_sequence_for<Stages...>{})) {
+                aggregator.Aggregator::Process(value);
+            }
+        }
+
+        void ProcessBatch(const int *values, size_t count) override {
+            for (size_t i = 0; i < count; ++i) {
+                int value = values[i];
+                if (Pass(value, std::index_sequence_for<Stages...>{})) {
+                    aggregator.Aggregator::Process(value);
+                }
+            }
+        }
+
+        void ProcessAt(int64_t timestamp, int value) override {
+            if (Pass(value, std::index_sequence_for<Stages...>{})) {
+                aggregator.Aggregator::ProcessAt(timestamp, value);
+            }
+        }
+
+        void PrintValue(std::ostream &out) const override {
+            aggregator.PrintValue(out);
+        }
+
+        std::unique_ptr<StatsAggregator> Clone() const override {
+            return std::make_unique<FusedPipeline>(*this);
+        }
+
+        void Merge(const StatsAggregator &other) override {
+            const auto *same = dynamic_cast<const FusedPipeline *>(&other);
+            if (same == nullptr) {
+                throw std::invalid_argument("FusedPipeline::Merge: different pipeline");
+            }
+            aggregator.Merge(same->aggregator);
+        }
+
+        void SaveState(std::string &out) const override {
+            aggregator.SaveState(out);
+        }
+
+        void LoadState(std::string_view &in) override {
+            aggregator.LoadState(in);
+        }
+
+    private:
+        // && останавливается на первой стадии, отбросившей значение
+        template<size_t... Is>
+        bool Pass(int &value, std::index_sequence<Is...>) {
+            return (std::get<Is>(stages)(value) && ...);
+        }
+
+        Aggregator aggregator;
+        std::tuple<Stages...> stages;
+    };
+
+    template<typename Aggregator, typename... Stages>
+    FusedPipeline<Aggregator, Stages...> MakeFusedPipeline(Aggregator aggregator, Stages... stages) {
+        return FusedPipeline<Aggregator, Stages...>(std::move(aggregator), std::move(stages)...);
+    }
+
+    void TestPipeline();
+
+    void TestFusedPipeline();
+
+}
@@ -0,0 +1,156 @@
+#include "stats_pipeline.h"
+#include "test_runner.h"
+
+#include <random>
+#include <sstream>
+
+using namespace std;
+
+namespace StatsAggregators {
+
+    namespace {
+        string Printed(const StatsAggregator &aggr) {
+            ostringstream output;
+            aggr.PrintValue(output);
+            return output.str();
+        }
+
+        vector<int> RandomValues(size_t count, uint32_t seed) {
+            mt19937 random(seed);
+            vector<int> result(count);
+            for (int &value : result) {
+                value = int(random() % 2001) - 1000;
+            }
+            return result;
+        }
+
+        bool Positive(int value) {
+            return value > 0;
+        }
+
+        int Triple(int value) {
+            return value * 3;
+        }
+    }
+
+    void TestPipeline() {
+        const vector<int> values = RandomValues(5000, 3);
+
+        // Сумма положительных и максимум утроенных считаются отдельным проходом
+        Sum expected_sum;
+        Max expected_max;
+        for (int value : values) {
+            if (value > 0) {
+                expected_sum.Process(value);
+            }
+            expected_max.Process(value * 3);
+        }
+
+        for (size_t split : {size_t(0), size_t(1), size_t(1023), size_t(1025), values.size()}) {
+            Pipeline sum(make_unique<Sum>());
+            sum.AddStage(Filter(Positive));
+            sum.ProcessBatch(values.data(), split);
+            for (size_t i = split; i < values.size(); ++i) {
+                sum.Process(values[i]);
+            }
+            ASSERT_EQUAL(Printed(sum), Printed(expected_sum));
+        }
+
+        Pipeline max(make_unique<Max>());
+        max.AddStage(Map(Triple));
+        max.ProcessBatch(values.data(), values.size());
+        ASSERT_EQUAL(Printed(max), Printed(expected_max));
+
+        // Стадии идут по порядку: сначала утроение, потом фильтр уже по утроенному
+        Pipeline ordered(make_unique<Min>());
+        ordered.AddStage(Map(Triple));
+        ordered.AddStage(Filter([](int value) { return value > 2; }));
+        const vector<int> small = {1, 2, -5, 0};
+        ordered.ProcessBatch(small.data(), small.size());
+        ASSERT_EQUAL(Printed(ordered), "Min is 3");
+
+        Pipeline none(make_unique<Sum>()), all(make_unique<Sum>());
+        none.AddStage(Sample(0));
+        all.AddStage(Sample(1));
+        Sum all_expected;
+        all_expected.ProcessBatch(values.data(), values.size());
+        none.ProcessBatch(values.data(), values.size());
+        all.ProcessBatch(values.data(), values.size());
+        ASSERT_EQUAL(Printed(none), "Sum is 0");
+        ASSERT_EQUAL(Printed(all), Printed(all_expected));
+
+        // Доля прошедших по Sample близка к заданной
+        Pipeline counted(make_unique<Sum>());
+        counted.AddStage(Sample(0.25));
+        const vector<int> ones(100000, 1);
+        counted.ProcessBatch(ones.data(), ones.size());
+        ostringstream printed;
+        counted.PrintValue(printed);
+        const int passed = stoi(printed.str().substr(string("Sum is ").size()));
+        ASSERT(passed > 24000 && passed < 26000);
+
+        // Копия и слияние работают с агрегатором, стадии остаются
+        Pipeline first(make_unique<Sum>());
+        first.AddStage(Filter(Positive));
+        auto second = first.Clone();
+        first.ProcessBatch(values.data(), 2000);
+        second->ProcessBatch(values.data() + 2000, values.size() - 2000);
+        first.Merge(*second);
+        ASSERT_EQUAL(Printed(first), Printed(expected_sum));
+
+        string state;
+        first.SaveState(state);
+        Pipeline restored(make_unique<Sum>());
+        string_view in = state;
+        restored.LoadState(in);
+        ASSERT_EQUAL(Printed(restored), Printed(expected_sum));
+
+        try {
+            first.Merge(Sum());
+            Assert(false, "Pipeline::Merge() should throw std::invalid_argument for another type");
+        } catch (invalid_argument &) {
+        }
+    }
+
+    void TestFusedPipeline() {
+        const vector<int> values = RandomValues(5000, 4);
+
+        auto positive = Filter([](int value) { return value > 0; });
+        auto triple = Map([](int value) { return value * 3; });
+
+        Pipeline dynamic(make_unique<StaticComposite<Sum, Min, Max, Average, Mode>>());
+        dynamic.AddStage(positive);
+        dynamic.AddStage(triple);
+        dynamic.AddStage(Sample(0.5, 7));
+        auto fused = MakeFusedPipeline(StaticComposite<Sum, Min, Max, Average, Mode>(), positive, triple, Sample(0.5, 7));
+
+        dynamic.ProcessBatch(values.data(), values.size());
+        fused.ProcessBatch(values.data(), 100);
+        for (size_t i = 100; i < values.size(); ++i) {
+            fused.Process(values[i]);
+        }
+        ASSERT_EQUAL(Printed(fused), Printed(dynamic));
+
+        auto no_stages = MakeFusedPipeline(Sum());
+        no_stages.ProcessBatch(values.data(), values.size());
+        Sum sum;
+        sum.ProcessBatch(values.data(), values.size());
+        ASSERT_EQUAL(Printed(no_stages), Printed(sum));
+
+        auto first = MakeFusedPipeline(Sum(), positive);
+        auto second = first;
+        first.ProcessBatch(values.data(), 1000);
+        second.ProcessBatch(values.data() + 1000, values.size() - 1000);
+        first.Merge(second);
+        auto whole = MakeFusedPipeline(Sum(), positive);
+        whole.ProcessBatch(values.data(), values.size());
+        ASSERT_EQUAL(Printed(first), Printed(whole));
+
+        try {
+            first.Merge(no_stages);
+            Assert(false, "FusedPipeline::Merge() should throw std::invalid_argument for another pipeline");
+        } catch (invalid_argument &) {
+        }
+    }
+
+}
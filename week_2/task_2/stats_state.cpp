@@ -0,0 +1,83 @@
+#include "stats_state.h"
+
+#include <climits>
+#include <stdexcept>
+
+using namespace std;
+
+namespace StatsAggregators {
+
+    void WriteTag(string &out, StateTag tag) {
+        out.push_back(static_cast<char>(tag));
+    }
+
+    void WriteUnsigned(string &out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    void WriteSigned(string &out, int64_t value) {
+        WriteUnsigned(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void WriteFixed64(string &out, uint64_t value) {
+        for (size_t i = 0; i < 8; ++i) {
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    }
+
+    void ReadTag(string_view &in, StateTag expected) {
+        if (in.empty() || static_cast<uint8_t>(in.front()) != static_cast<uint8_t>(expected)) {
+            throw invalid_argument("StatsAggregator::LoadState: state of another aggregator");
+        }
+        in.remove_prefix(1);
+    }
+
+    uint64_t ReadUnsigned(string_view &in) {
+        uint64_t value = 0;
+        for (int shift = 0; !in.empty() && shift < 64; shift += 7) {
+            const auto byte = static_cast<uint8_t>(in.front());
+            in.remove_prefix(1);
+            value |= uint64_t(byte & 0x7F) << shift;
+            if (byte < 0x80) {
+                return value;
+            }
+        }
+        throw invalid_argument("StatsAggregator::LoadState: truncated state");
+    }
+
+    int64_t ReadSigned(string_view &in) {
+        const uint64_t value = ReadUnsigned(in);
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    int ReadInt(string_view &in) {
+        const int64_t value = ReadSigned(in);
+        if (value < INT_MIN || value > INT_MAX) {
+            throw invalid_argument("StatsAggregator::LoadState: value out of int range");
+        }
+        return static_cast<int>(value);
+    }
+
+    uint64_t ReadFixed64(string_view &in) {
+        const string_view bytes = ReadBytes(in, 8);
+        uint64_t value = 0;
+        for (size_t i = 0; i < 8; ++i) {
+            value |= uint64_t(static_cast<uint8_t>(bytes[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    string_view ReadBytes(string_view &in, size_t size) {
+        if (in.size() < size) {
+            throw invalid_argument("StatsAggregator::LoadState: truncated state");
+        }
+        const string_view result = in.substr(0, size);
+        in.remove_prefix(size);
+        return result;
+    }
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Кодирование состояния агрегаторов для SaveState и LoadState.
+// Целые — LEB128 (знаковые через zigzag), 64-битные слова — little-endian.
+// Чтение снимает прочитанное с начала in; оборванные данные
+// и неожиданные значения приводят к invalid_argument.
+namespace StatsAggregators {
+
+    // Первый байт состояния каждого агрегатора: по нему LoadState
+    // отличает чужое состояние от своего
+    enum class StateTag : uint8_t {
+        Sum = 1,
+        Min = 2,
+        Max = 3,
+        Average = 4,
+        Mode = 5,
+        ApproximateMode = 6,
+        Quantile = 7,
+        Distinct = 8,
+        Composite = 9,
+        WindowedSum = 10,
+        WindowedAverage = 11,
+        WindowedMin = 12,
+        WindowedMax = 13,
+        WindowedMode = 14,
+    };
+
+    void WriteTag(std::string &out, StateTag tag);
+
+    void WriteUnsigned(std::string &out, uint64_t value);
+
+    void WriteSigned(std::string &out, int64_t value);
+
+    void WriteFixed64(std::string &out, uint64_t value);
+
+    void ReadTag(std::string_view &in, StateTag expected);
+
+    uint64_t ReadUnsigned(std::string_view &in);
+
+    int64_t ReadSigned(std::string_view &in);
+
+    // ReadSigned с проверкой, что значение помещается в int
+    int ReadInt(std::string_view &in);
+
+    uint64_t ReadFixed64(std::string_view &in);
+
+    // Первые size байт in
+    std::string_view ReadBytes(std::string_view &in, size_t size);
+
+}
@@ -0,0 +1,370 @@
+#include "stats_window.h"
+
+#include <algorithm>
+#include <typeinfo>
+
+using namespace std;
+
+namespace StatsAggregators {
+
+    namespace {
+        // Мультипликативное хеширование: старшие биты произведения
+        // перемешаны лучше, чем само значение
+        size_t IndexHash(int value) {
+            const uint64_t product = static_cast<uint32_t>(value) * 0x9E3779B97F4A7C15ull;
+            return static_cast<size_t>(product ^ (product >> 32));
+        }
+    }
+
+    WindowSpan WindowSpan::Values(int64_t count) {
+        return {count, Unit::Values};
+    }
+
+    WindowSpan WindowSpan::Seconds(int64_t seconds) {
+        return {seconds, Unit::Seconds};
+    }
+
+    WindowSpan WindowSpan::Parse(const string &text) {
+        const bool seconds = !text.empty() && text.back() == 's';
+        const string digits = text.substr(0, text.size() - seconds);
+        if (digits.empty() || !all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            throw invalid_argument("WindowSpan::Parse: bad window " + text);
+        }
+        const int64_t length = stoll(digits);
+        if (length <= 0) {
+            throw invalid_argument("WindowSpan::Parse: empty window " + text);
+        }
+        return seconds ? Seconds(length) : Values(length);
+    }
+
+    bool WindowSpan::operator==(const WindowSpan &other) const {
+        return length == other.length && unit == other.unit;
+    }
+
+    ostream &operator<<(ostream &out, const WindowSpan &span) {
+        return out << "last " << span.length << (span.unit == WindowSpan::Unit::Values ? " values" : " seconds");
+    }
+
+    WindowedAggregator::WindowedAggregator(WindowSpan span) : span(span) {
+    }
+
+    const WindowSpan &WindowedAggregator::Span() const {
+        return span;
+    }
+
+    void WindowedAggregator::Process(int value) {
+        ProcessAt(clock, value);
+    }
+
+    void WindowedAggregator::ProcessAt(int64_t timestamp, int value) {
+        clock = span.unit == WindowSpan::Unit::Values ? clock + 1 : max(clock, timestamp);
+        window.emplace_back(clock, value);
+        Add(value);
+
+        // В окне остаются значения с меткой из (clock - length, clock]
+        while (window.front().first <= clock - span.length) {
+            Remove(window.front().second);
+            window.pop_front();
+        }
+    }
+
+    void WindowedAggregator::ProcessBatch(const int *values, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            WindowedAggregator::ProcessAt(clock, values[i]);
+        }
+    }
+
+    void WindowedAggregator::Merge(const StatsAggregator &other) {
+        if (typeid(*this) != typeid(other)) {
+            throw invalid_argument("StatsAggregator::Merge: aggregators of different types");
+        }
+        const auto &same = static_cast<const WindowedAggregator &>(other);
+        if (!(same.span == span)) {
+            throw invalid_argument("WindowedAggregator::Merge: different windows");
+        }
+        for (const auto &[timestamp, value] : same.window) {
+            ProcessAt(timestamp, value);
+        }
+    }
+
+    // Метки не убывают, поэтому после первой пишутся приращения
+    void WindowedAggregator::SaveState(string &out) const {
+        WriteTag(out, Tag());
+        WriteUnsigned(out, static_cast<uint64_t>(span.unit));
+        WriteSigned(out, span.length);
+        WriteSigned(out, clock);
+        WriteUnsigned(out, window.size());
+        int64_t previous = window.empty() ? 0 : window.front().first;
+        WriteSigned(out, previous);
+        for (const auto &[timestamp, value] : window) {
+            WriteUnsigned(out, static_cast<uint64_t>(timestamp - previous));
+            WriteSigned(out, value);
+            previous = timestamp;
+        }
+    }
+
+    void WindowedAggregator::LoadState(string_view &in) {
+        ReadTag(in, Tag());
+        const uint64_t unit = ReadUnsigned(in);
+        const int64_t length = ReadSigned(in);
+        if (unit != static_cast<uint64_t>(span.unit) || length != span.length) {
+            throw invalid_argument("WindowedAggregator::LoadState: different windows");
+        }
+
+        const int64_t loaded_clock = ReadSigned(in);
+        const uint64_t size = ReadUnsigned(in);
+        int64_t timestamp = ReadSigned(in);
+        deque<pair<int64_t, int>> loaded;
+        for (uint64_t i = 0; i < size; ++i) {
+            timestamp += static_cast<int64_t>(ReadUnsigned(in));
+            // Значение за пределами окна уже должно было из него выйти
+            if (timestamp > loaded_clock || timestamp <= loaded_clock - span.length) {
+                throw invalid_argument("WindowedAggregator::LoadState: value outside of the window");
+            }
+            loaded.emplace_back(timestamp, ReadInt(in));
+        }
+
+        Clear();
+        clock = loaded_clock;
+        window = move(loaded);
+        for (const auto &entry : window) {
+            Add(entry.second);
+        }
+    }
+
+    void WindowedSum::Add(int value) {
+        sum += static_cast<uint32_t>(value);
+    }
+
+    void WindowedSum::Remove(int value) {
+        sum -= static_cast<uint32_t>(value);
+    }
+
+    void WindowedSum::Clear() {
+        sum = 0;
+    }
+
+    StateTag WindowedSum::Tag() const {
+        return StateTag::WindowedSum;
+    }
+
+    void WindowedSum::PrintValue(ostream &out) const {
+        out << "Sum over " << Span() << " is " << static_cast<int>(sum);
+    }
+
+    unique_ptr<StatsAggregator> WindowedSum::Clone() const {
+        return make_unique<WindowedSum>(*this);
+    }
+
+    void WindowedAverage::Add(int value) {
+        sum += static_cast<uint32_t>(value);
+        ++total;
+    }
+
+    void WindowedAverage::Remove(int value) {
+        sum -= static_cast<uint32_t>(value);
+        --total;
+    }
+
+    void WindowedAverage::Clear() {
+        sum = 0;
+        total = 0;
+    }
+
+    StateTag WindowedAverage::Tag() const {
+        return StateTag::WindowedAverage;
+    }
+
+    void WindowedAverage::PrintValue(ostream &out) const {
+        out << "Average over " << Span() << " is ";
+        if (total == 0) {
+            out << "undefined";
+        } else {
+            out << static_cast<int>(sum) / total;
+        }
+    }
+
+    unique_ptr<StatsAggregator> WindowedAverage::Clone() const {
+        return make_unique<WindowedAverage>(*this);
+    }
+
+    template<bool IsMin>
+    void WindowedExtremum<IsMin>::Add(int value) {
+        while (!candidates.empty() && (IsMin ? candidates.back() > value : candidates.back() < value)) {
+            candidates.pop_back();
+        }
+        candidates.push_back(value);
+    }
+
+    template<bool IsMin>
+    void WindowedExtremum<IsMin>::Remove(int value) {
+        if (candidates.front() == value) {
+            candidates.pop_front();
+        }
+    }
+
+    template<bool IsMin>
+    void WindowedExtremum<IsMin>::Clear() {
+        candidates.clear();
+    }
+
+    template<bool IsMin>
+    StateTag WindowedExtremum<IsMin>::Tag() const {
+        return IsMin ? StateTag::WindowedMin : StateTag::WindowedMax;
+    }
+
+    template<bool IsMin>
+    void WindowedExtremum<IsMin>::PrintValue(ostream &out) const {
+        out << (IsMin ? "Min over " : "Max over ") << Span() << " is ";
+        if (candidates.empty()) {
+            out << "undefined";
+        } else {
+            out << candidates.front();
+        }
+    }
+
+    template<bool IsMin>
+    unique_ptr<StatsAggregator> WindowedExtremum<IsMin>::Clone() const {
+        return make_unique<WindowedExtremum>(*this);
+    }
+
+    template class WindowedExtremum<true>;
+    template class WindowedExtremum<false>;
+
+    void WindowedMode::Link(uint32_t node) {
+        Node &linked = nodes[node];
+        if (linked.count >= int(heads.size())) {
+            heads.push_back(NONE);
+        }
+        linked.prev = NONE;
+        linked.next = heads[linked.count];
+        if (linked.next != NONE) {
+            nodes[linked.next].prev = node;
+        }
+        heads[linked.count] = node;
+    }
+
+    void WindowedMode::Unlink(uint32_t node) {
+        const Node &unlinked = nodes[node];
+        if (unlinked.prev != NONE) {
+            nodes[unlinked.prev].next = unlinked.next;
+        } else {
+            heads[unlinked.count] = unlinked.next;
+        }
+        if (unlinked.next != NONE) {
+            nodes[unlinked.next].prev = unlinked.prev;
+        }
+    }
+
+    size_t WindowedMode::FindSlot(int value) const {
+        const size_t mask = index.size() - 1;
+        for (size_t slot = IndexHash(value) & mask;; slot = (slot + 1) & mask) {
+            if (index[slot].node == NONE || index[slot].value == value) {
+                return slot;
+            }
+        }
+    }
+
+    void WindowedMode::GrowIndex() {
+        vector<Slot> old = move(index);
+        index.assign(max<size_t>(old.size() * 2, 16), Slot{});
+        for (const Slot &slot : old) {
+            if (slot.node != NONE) {
+                index[FindSlot(slot.value)] = slot;
+            }
+        }
+    }
+
+    void WindowedMode::EraseSlot(size_t slot) {
+        const size_t mask = index.size() - 1;
+        size_t hole = slot;
+        for (size_t next = (slot + 1) & mask; index[next].node != NONE; next = (next + 1) & mask) {
+            // Запись можно сдвинуть в дыру, если дыра не раньше её домашнего слота
+            const size_t home = IndexHash(index[next].value) & mask;
+            if (((next - home) & mask) >= ((next - hole) & mask)) {
+                index[hole] = index[next];
+                hole = next;
+            }
+        }
+        index[hole] = Slot{};
+    }
+
+    void WindowedMode::Add(int value) {
+        if ((index_size + 1) * 2 > index.size()) {
+            GrowIndex();
+        }
+        Slot &slot = index[FindSlot(value)];
+        if (slot.node == NONE) {
+            if (!free_nodes.empty()) {
+                slot.node = free_nodes.back();
+                free_nodes.pop_back();
+            } else {
+                slot.node = static_cast<uint32_t>(nodes.size());
+                nodes.emplace_back();
+            }
+            slot.value = value;
+            ++index_size;
+            nodes[slot.node] = {value, 0, 0, NONE, NONE};
+        } else {
+            Unlink(slot.node);
+        }
+
+        const uint32_t node = slot.node;
+        ++nodes[node].count;
+        nodes[node].last_seen = ++added;
+        Link(node);
+        max_count = max(max_count, nodes[node].count);
+    }
+
+    // Частота уменьшается на единицу, поэтому если список наибольшей
+    // частоты опустел, значение оказалось в соседнем, и он не пуст
+    void WindowedMode::Remove(int value) {
+        const size_t slot = FindSlot(value);
+        const uint32_t node = index[slot].node;
+        Unlink(node);
+        if (--nodes[node].count == 0) {
+            free_nodes.push_back(node);
+            EraseSlot(slot);
+            --index_size;
+        } else {
+            Link(node);
+        }
+        if (heads[max_count] == NONE) {
+            --max_count;
+        }
+    }
+
+    void WindowedMode::Clear() {
+        index.clear();
+        index_size = 0;
+        nodes.clear();
+        free_nodes.clear();
+        heads = {NONE};
+        max_count = 0;
+        added = 0;
+    }
+
+    StateTag WindowedMode::Tag() const {
+        return StateTag::WindowedMode;
+    }
+
+    void WindowedMode::PrintValue(ostream &out) const {
+        out << "Mode over " << Span() << " is ";
+        if (max_count == 0) {
+            out << "undefined";
+            return;
+        }
+        uint32_t mode = heads[max_count];
+        for (uint32_t node = nodes[mode].next; node != NONE; node = nodes[node].next) {
+            if (nodes[node].last_seen > nodes[mode].last_seen) {
+                mode = node;
+            }
+        }
+        out << nodes[mode].value;
+    }
+
+    unique_ptr<StatsAggregator> WindowedMode::Clone() const {
+        return make_unique<WindowedMode>(*this);
+    }
+
+}
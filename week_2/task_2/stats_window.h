@@ -0,0 +1,241 @@
+#pragma once
+
+#include "stats_aggregator.h"
+#include "stats_state.h"
+
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace StatsAggregators {
+
+    // Окно: последние length значений или значения за последние length секунд
+    struct WindowSpan {
+        enum class Unit {
+            Values,
+            Seconds,
+        };
+
+        int64_t length;
+        Unit unit;
+
+        static WindowSpan Values(int64_t count);
+
+        static WindowSpan Seconds(int64_t seconds);
+
+        // "100" — последние 100 значений, "10s" — последние 10 секунд.
+        // Некорректная запись приводит к invalid_argument.
+        static WindowSpan Parse(const std::string &text);
+
+        bool operator==(const WindowSpan &other) const;
+    };
+
+    std::ostream &operator<<(std::ostream &out, const WindowSpan &span);
+
+    // Общая часть оконных агрегаторов: хранит значения окна в порядке
+    // поступления и сообщает наследнику о каждом вошедшем и вышедшем
+    // значении. Значения выходят строго в порядке входа, поэтому
+    // наследникам хватает O(1) амортизированной работы на значение.
+    //
+    // В окне по времени метки не должны убывать: более ранняя метка
+    // считается равной последней. Process без метки тоже берёт последнюю.
+    class WindowedAggregator : public StatsAggregator {
+    public:
+        explicit WindowedAggregator(WindowSpan span);
+
+        void Process(int value) final;
+
+        void ProcessAt(int64_t timestamp, int value) final;
+
+        void ProcessBatch(const int *values, size_t count) final;
+
+        // Значения окна other добавляются после своих. other должен быть
+        // того же типа и с тем же окном, иначе invalid_argument.
+        void Merge(const StatsAggregator &other) final;
+
+        // Сохраняется только само окно; LoadState заново прогоняет
+        // его значения через Add, и наследник восстанавливает своё
+        void SaveState(std::string &out) const final;
+
+        void LoadState(std::string_view &in) final;
+
+    protected:
+        const WindowSpan &Span() const;
+
+        virtual void Add(int value) = 0;
+
+        // Вызывается для самого старого значения окна
+        virtual void Remove(int value) = 0;
+
+        // Забывает все значения, как будто окно только что создано
+        virtual void Clear() = 0;
+
+        virtual StateTag Tag() const = 0;
+
+    private:
+        WindowSpan span;
+        // Номер значения для окна по количеству, последняя метка — для окна по времени
+        int64_t clock = 0;
+        std::deque<std::pair<int64_t, int>> window;
+    };
+
+    class WindowedSum : public WindowedAggregator {
+    public:
+        using WindowedAggregator::WindowedAggregator;
+
+        void PrintValue(std::ostream &out) const override;
+
+        std::unique_ptr<StatsAggregator> Clone() const override;
+
+    protected:
+        void Add(int value) override;
+
+        void Remove(int value) override;
+
+        void Clear() override;
+
+        StateTag Tag() const override;
+
+    private:
+        uint32_t sum = 0;
+    };
+
+    class WindowedAverage : public WindowedAggregator {
+    public:
+        using WindowedAggregator::WindowedAggregator;
+
+        void PrintValue(std::ostream &out) const override;
+
+        std::unique_ptr<StatsAggregator> Clone() const override;
+
+    protected:
+        void Add(int value) override;
+
+        void Remove(int value) override;
+
+        void Clear() override;
+
+        StateTag Tag() const override;
+
+    private:
+        uint32_t sum = 0;
+        int64_t total = 0;
+    };
+
+    // Монотонная очередь: значение, которое пришло позже и не больше
+    // (для Max — не меньше) уже стоящих, делает их бесполезными, пока
+    // оно в окне. Равные значения остаются, чтобы Remove снимал их по одному.
+    template<bool IsMin>
+    class WindowedExtremum : public WindowedAggregator {
+    public:
+        using WindowedAggregator::WindowedAggregator;
+
+        void PrintValue(std::ostream &out) const override;
+
+        std::unique_ptr<StatsAggregator> Clone() const override;
+
+    protected:
+        void Add(int value) override;
+
+        void Remove(int value) override;
+
+        void Clear() override;
+
+        StateTag Tag() const override;
+
+    private:
+        std::deque<int> candidates;
+    };
+
+    using WindowedMin = WindowedExtremum<true>;
+    using WindowedMax = WindowedExtremum<false>;
+
+    extern template class WindowedExtremum<true>;
+    extern template class WindowedExtremum<false>;
+
+    // Значения с одинаковой частотой связаны в список своей частоты,
+    // так что и вход, и выход значения стоят O(1) операций. Среди значений
+    // с наибольшей частотой модой считается встречавшееся в окне позже
+    // всех; выбор зависит только от содержимого окна, поэтому Merge
+    // даёт тот же ответ, что и один проход. PrintValue перебирает
+    // только значения с наибольшей частотой.
+    //
+    // Узлы найдены через плоскую таблицу с открытой адресацией, без
+    // выделения памяти на значение. Каждое обновление всё же касается
+    // нескольких случайных мест в памяти: пока различных значений окна
+    // несколько тысяч, они в кэше, а на окнах в сотни тысяч различных
+    // значений время обновления ограничено промахами кэша и растёт
+    // в разы (см. MeasureWindows в stats_benchmark.cpp).
+    class WindowedMode : public WindowedAggregator {
+    public:
+        using WindowedAggregator::WindowedAggregator;
+
+        void PrintValue(std::ostream &out) const override;
+
+        std::unique_ptr<StatsAggregator> Clone() const override;
+
+    protected:
+        void Add(int value) override;
+
+        void Remove(int value) override;
+
+        void Clear() override;
+
+        StateTag Tag() const override;
+
+    private:
+        static constexpr uint32_t NONE = UINT32_MAX;
+
+        struct Node {
+            int value = 0;
+            int count = 0;
+            uint64_t last_seen = 0;
+            uint32_t prev = NONE;
+            uint32_t next = NONE;
+        };
+
+        // node == NONE — пустой слот
+        struct Slot {
+            int value = 0;
+            uint32_t node = NONE;
+        };
+
+        void Link(uint32_t node);
+
+        void Unlink(uint32_t node);
+
+        // Слот со значением value или пустой слот, куда его вставить
+        size_t FindSlot(int value) const;
+
+        void GrowIndex();
+
+        // Удаляет запись со сдвигом следующих назад, без надгробий
+        void EraseSlot(size_t slot);
+
+        // Линейное пробирование, заполнение не больше половины
+        std::vector<Slot> index;
+        size_t index_size = 0;
+        std::vector<Node> nodes;
+        std::vector<uint32_t> free_nodes;
+        // heads[c] — первый узел с частотой c
+        std::vector<uint32_t> heads = {NONE};
+        int max_count = 0;
+        uint64_t added = 0;
+    };
+
+    void TestWindowedSum();
+
+    void TestWindowedMinMax();
+
+    void TestWindowedMode();
+
+    void TestWindowedByTime();
+
+    void TestWindowedMerge();
+
+    void TestWindowedState();
+
+}
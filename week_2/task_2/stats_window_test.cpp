@@ -0,0 +1,267 @@
+#include "stats_window.h"
+#include "test_runner.h"
+
+#include <algorithm>
+#include <climits>
+#include <deque>
+#include <map>
+#include <random>
+#include <sstream>
+
+using namespace std;
+
+namespace StatsAggregators {
+
+    namespace {
+        string Printed(const StatsAggregator &aggr) {
+            ostringstream output;
+            aggr.PrintValue(output);
+            return output.str();
+        }
+
+        // Считает ответ перебором окна после каждого значения
+        class ReferenceWindow {
+        public:
+            explicit ReferenceWindow(size_t length) : length(length) {
+            }
+
+            void Process(int value) {
+                window.push_back(value);
+                if (window.size() > length) {
+                    window.pop_front();
+                }
+            }
+
+            int Sum() const {
+                uint32_t sum = 0;
+                for (int value : window) {
+                    sum += static_cast<uint32_t>(value);
+                }
+                return static_cast<int>(sum);
+            }
+
+            int Min() const {
+                return *min_element(window.begin(), window.end());
+            }
+
+            int Max() const {
+                return *max_element(window.begin(), window.end());
+            }
+
+            int Mode() const {
+                map<int, int> count;
+                map<int, size_t> last_position;
+                for (size_t i = 0; i < window.size(); ++i) {
+                    ++count[window[i]];
+                    last_position[window[i]] = i;
+                }
+                int mode = 0, mode_count = 0;
+                for (const auto &[value, value_count] : count) {
+                    if (value_count > mode_count
+                        || (value_count == mode_count && last_position[value] > last_position[mode])) {
+                        mode = value;
+                        mode_count = value_count;
+                    }
+                }
+                return mode;
+            }
+
+        private:
+            size_t length;
+            deque<int> window;
+        };
+
+        vector<int> RandomValues(size_t count, int range, uint32_t seed) {
+            mt19937 random(seed);
+            vector<int> result(count);
+            for (int &value : result) {
+                value = int(random() % range) - range / 2;
+            }
+            return result;
+        }
+    }
+
+    void TestWindowedSum() {
+        WindowedSum sum(WindowSpan::Values(3));
+        WindowedAverage average(WindowSpan::Values(3));
+        ASSERT_EQUAL(Printed(sum), "Sum over last 3 values is 0");
+        ASSERT_EQUAL(Printed(average), "Average over last 3 values is undefined");
+
+        ReferenceWindow reference(3);
+        for (int value : {5, -2, 7, 10, 1, INT_MAX, INT_MAX}) {
+            sum.Process(value);
+            average.Process(value);
+            reference.Process(value);
+            ASSERT_EQUAL(Printed(sum), "Sum over last 3 values is " + to_string(reference.Sum()));
+        }
+        // Сумма переполняется так же, как у Sum: 1 + 2 * INT_MAX по модулю 2^32
+        ASSERT_EQUAL(Printed(sum), "Sum over last 3 values is -1");
+        ASSERT_EQUAL(Printed(average), "Average over last 3 values is 0");
+    }
+
+    void TestWindowedMinMax() {
+        for (size_t length : {1u, 2u, 7u, 100u}) {
+            WindowedMin min_aggr(WindowSpan::Values(length));
+            WindowedMax max_aggr(WindowSpan::Values(length));
+            ASSERT_EQUAL(Printed(min_aggr), "Min over last " + to_string(length) + " values is undefined");
+
+            ReferenceWindow reference(length);
+            for (int value : RandomValues(1000, 20, length)) {
+                min_aggr.Process(value);
+                max_aggr.Process(value);
+                reference.Process(value);
+                ASSERT_EQUAL(Printed(min_aggr), "Min over last " + to_string(length) + " values is " + to_string(reference.Min()));
+                ASSERT_EQUAL(Printed(max_aggr), "Max over last " + to_string(length) + " values is " + to_string(reference.Max()));
+            }
+        }
+    }
+
+    void TestWindowedMode() {
+        // Узкий диапазон даёт частые ничьи, широкий — рост и удаления в индексе
+        const vector<pair<size_t, int>> cases = {{1, 8}, {3, 8}, {10, 8}, {64, 8}, {300, 1000}};
+        for (const auto &[length, range] : cases) {
+            WindowedMode mode(WindowSpan::Values(length));
+            ASSERT_EQUAL(Printed(mode), "Mode over last " + to_string(length) + " values is undefined");
+
+            ReferenceWindow reference(length);
+            for (int value : RandomValues(2000, range, length + 1)) {
+                mode.Process(value);
+                reference.Process(value);
+                ASSERT_EQUAL(Printed(mode), "Mode over last " + to_string(length) + " values is " + to_string(reference.Mode()));
+            }
+        }
+    }
+
+    void TestWindowedByTime() {
+        WindowedMax max_aggr(WindowSpan::Seconds(10));
+        WindowedSum sum(WindowSpan::Seconds(10));
+
+        max_aggr.ProcessAt(100, 50);
+        sum.ProcessAt(100, 50);
+        max_aggr.ProcessAt(105, 20);
+        sum.ProcessAt(105, 20);
+        ASSERT_EQUAL(Printed(max_aggr), "Max over last 10 seconds is 50");
+        ASSERT_EQUAL(Printed(sum), "Sum over last 10 seconds is 70");
+
+        // Метка 110 вытесняет всё, что старше 100 < t
+        max_aggr.ProcessAt(110, 30);
+        sum.ProcessAt(110, 30);
+        ASSERT_EQUAL(Printed(max_aggr), "Max over last 10 seconds is 30");
+        ASSERT_EQUAL(Printed(sum), "Sum over last 10 seconds is 50");
+
+        // Запоздавшая метка и значение без метки относятся к последней метке
+        sum.ProcessAt(90, 1);
+        sum.Process(2);
+        ASSERT_EQUAL(Printed(sum), "Sum over last 10 seconds is 53");
+
+        sum.ProcessAt(200, 4);
+        ASSERT_EQUAL(Printed(sum), "Sum over last 10 seconds is 4");
+
+        // Метки не обязаны помещаться в int
+        const int64_t epoch_ms = 1700000000000;
+        sum.ProcessAt(epoch_ms, 5);
+        sum.ProcessAt(epoch_ms + 9, 6);
+        ASSERT_EQUAL(Printed(sum), "Sum over last 10 seconds is 11");
+        sum.ProcessAt(epoch_ms + 10, 7);
+        ASSERT_EQUAL(Printed(sum), "Sum over last 10 seconds is 13");
+
+        ASSERT(WindowSpan::Parse("10s") == WindowSpan::Seconds(10));
+        ASSERT(WindowSpan::Parse("250") == WindowSpan::Values(250));
+        for (const char *bad : {"", "s", "0", "-5", "10m", "1s0"}) {
+            try {
+                WindowSpan::Parse(bad);
+                Assert(false, "WindowSpan::Parse() should throw std::invalid_argument for " + string(bad));
+            } catch (invalid_argument &) {
+            }
+        }
+    }
+
+    void TestWindowedMerge() {
+        const vector<int> values = RandomValues(300, 10, 5);
+        const WindowSpan span = WindowSpan::Values(40);
+
+        auto make_composite = [&span] {
+            Composite aggr;
+            aggr.Add(make_unique<WindowedSum>(span));
+            aggr.Add(make_unique<WindowedMin>(span));
+            aggr.Add(make_unique<WindowedMode>(span));
+            return aggr;
+        };
+
+        Composite expected = make_composite();
+        expected.ProcessBatch(values.data(), values.size());
+
+        for (size_t split : {size_t(0), size_t(20), size_t(150), size_t(290), values.size()}) {
+            Composite first = make_composite(), second = make_composite();
+            first.ProcessBatch(values.data(), split);
+            second.ProcessBatch(values.data() + split, values.size() - split);
+            first.Merge(second);
+            ASSERT_EQUAL(Printed(first), Printed(expected));
+        }
+
+        WindowedSum sum(span);
+        try {
+            sum.Merge(WindowedSum(WindowSpan::Values(41)));
+            Assert(false, "WindowedAggregator::Merge() should throw std::invalid_argument for another window");
+        } catch (invalid_argument &) {
+        }
+        try {
+            sum.Merge(WindowedMin(span));
+            Assert(false, "WindowedAggregator::Merge() should throw std::invalid_argument for another type");
+        } catch (invalid_argument &) {
+        }
+    }
+
+    void TestWindowedState() {
+        const vector<int> values = RandomValues(500, 12, 9);
+
+        auto make_composite = [] {
+            Composite aggr;
+            aggr.Add(make_unique<WindowedSum>(WindowSpan::Values(40)));
+            aggr.Add(make_unique<WindowedAverage>(WindowSpan::Values(40)));
+            aggr.Add(make_unique<WindowedMin>(WindowSpan::Values(7)));
+            aggr.Add(make_unique<WindowedMax>(WindowSpan::Values(7)));
+            aggr.Add(make_unique<WindowedMode>(WindowSpan::Values(25)));
+            aggr.Add(make_unique<WindowedMode>(WindowSpan::Seconds(10)));
+            return aggr;
+        };
+
+        for (size_t split : {size_t(0), size_t(3), size_t(100), values.size()}) {
+            Composite original = make_composite();
+            for (size_t i = 0; i < split; ++i) {
+                original.ProcessAt(int64_t(i / 4), values[i]);
+            }
+            string state;
+            original.SaveState(state);
+
+            // Окна наследников перезаписываются целиком
+            Composite restored = make_composite();
+            restored.ProcessBatch(values.data(), 50);
+            string_view in = state;
+            restored.LoadState(in);
+            ASSERT(in.empty());
+            ASSERT_EQUAL(Printed(restored), Printed(original));
+
+            for (size_t i = split; i < values.size(); ++i) {
+                original.ProcessAt(int64_t(i / 4), values[i]);
+                restored.ProcessAt(int64_t(i / 4), values[i]);
+            }
+            ASSERT_EQUAL(Printed(restored), Printed(original));
+        }
+
+        string state;
+        WindowedSum(WindowSpan::Values(10)).SaveState(state);
+        vector<unique_ptr<StatsAggregator>> others;
+        others.push_back(make_unique<WindowedSum>(WindowSpan::Seconds(10)));
+        others.push_back(make_unique<WindowedMin>(WindowSpan::Values(10)));
+        for (const auto &other : others) {
+            try {
+                string_view in = state;
+                other->LoadState(in);
+                Assert(false, "WindowedAggregator::LoadState() should throw std::invalid_argument for another window");
+            } catch (invalid_argument &) {
+            }
+        }
+    }
+
+}